@@ -28,6 +28,7 @@
 #include <android-base/logging.h>
 #include <hidl-util/FQName.h>
 #include <hidl-util/Formatter.h>
+#include <hidl-util/Profiler.h>
 #include <hidl-util/StringHelper.h>
 #include <stdlib.h>
 #include <algorithm>
@@ -61,6 +62,11 @@ const Hash* AST::getFileHash() const {
     return mFileHash;
 }
 
+const std::vector<uint8_t>& AST::getOutputHash() const {
+    if (mCoordinator->isUnfrozen(getFilename())) return Hash::kEmptyHash;
+    return mFileHash->raw();
+}
+
 bool AST::setPackage(const char *package) {
     if (!mPackage.setTo(package)) {
         return false;
@@ -87,281 +93,272 @@ bool AST::definesInterfaces() const {
     return mRootScope.definesInterfaces();
 }
 
+// Bump whenever the format of content hashes changes.
+static const char* const kValidationCacheVersion = "hidl-gen-validation-1";
+
+const std::string& AST::getContentHash() const {
+    return mContentHash;
+}
+
+void AST::computeContentHash() {
+    // Keys include the hash of hidl-gen, since another one may validate
+    // differently.
+    if (!mCoordinator->hasCache()) return;
+
+    std::vector<std::string> importedHashes;
+    for (const AST* ast : mImportedASTs) {
+        if (ast->getContentHash().empty()) return;
+        importedHashes.push_back(ast->getContentHash());
+    }
+    std::sort(importedHashes.begin(), importedHashes.end());
+
+    mContentHash = Hash::hexString(Hash::sha256(
+        std::string(kValidationCacheVersion) + " " + Coordinator::getToolHash() + " " +
+        mFileHash->hexString() + " " +
+        StringHelper::JoinStrings(importedHashes, " ")));
+}
+
 status_t AST::postParse() {
     status_t err;
 
-    // lookupTypes is the first pass for references to be resolved.
-    err = lookupTypes();
-    if (err != OK) return err;
+    // Imports are all parsed at this point.
+    computeContentHash();
+
+    // The passes which only validate depend on nothing but the contents of
+    // this file and the files it imports, so they are skipped if they passed
+    // for the same contents before. This is all the cache saves here: parsed
+    // types, resolved references and constant values are not serialized, so
+    // the file is still lexed and parsed, and the passes which resolve and
+    // evaluate still run.
+    const std::string validatedKey = mContentHash.empty() ? "" : "validated-" + mContentHash;
+    const bool validated = !validatedKey.empty() && mCoordinator->isCached(validatedKey);
 
+    // Passes are fused into as few traversals as possible. A pass has to
+    // start a new traversal if it depends on an earlier pass having run on
+    // all types, not just on the ones it reaches.
+    std::vector<TypePass> passes;
+
+    // lookupTypes is the first pass for references to be resolved.
+    passes.push_back([&](Type* type) { return lookupTypes(type); });
     // Indicate that all types are now in "postParse" stage.
-    err = setParseStage(Type::ParseStage::PARSE, Type::ParseStage::POST_PARSE);
+    passes.push_back([](Type* type) {
+        type->setParseStage(Type::ParseStage::POST_PARSE);
+        return OK;
+    });
+    if (!validated) {
+        // validateDefinedTypesUniqueNames is the first call
+        // after lookup, as other errors could appear because
+        // user meant different type than we assumed.
+        passes.push_back([&](Type* type) { return validateDefinedTypesUniqueNames(type); });
+    }
+    err = runPasses("postParse: lookupTypes", Type::ParseStage::PARSE, passes);
     if (err != OK) return err;
+    passes.clear();
 
-    // validateDefinedTypesUniqueNames is the first call
-    // after lookup, as other errors could appear because
-    // user meant different type than we assumed.
-    err = validateDefinedTypesUniqueNames();
-    if (err != OK) return err;
     // topologicalReorder is before resolveInheritance, as we
     // need to have no cycle while getting parent class.
-    err = topologicalReorder();
-    if (err != OK) return err;
-    err = resolveInheritance();
-    if (err != OK) return err;
-    err = lookupConstantExpressions();
-    if (err != OK) return err;
-    // checkAcyclicConstantExpressions is after resolveInheritance,
-    // as resolveInheritance autofills enum values.
-    err = checkAcyclicConstantExpressions();
-    if (err != OK) return err;
-    err = validateConstantExpressions();
-    if (err != OK) return err;
-    err = evaluateConstantExpressions();
-    if (err != OK) return err;
-    err = validate();
+    std::unordered_map<const Type*, size_t> reversedOrder;
+    err = topologicalOrder(&reversedOrder);
     if (err != OK) return err;
-    err = checkForwardReferenceRestrictions();
+    passes.push_back([&](Type* type) { return topologicalReorder(type, reversedOrder); });
+    passes.push_back([](Type* type) { return type->resolveInheritance(); });
+    err = runPasses("postParse: resolveInheritance", Type::ParseStage::POST_PARSE, passes);
     if (err != OK) return err;
-    err = gatherReferencedTypes();
+    passes.clear();
+
+    // Constant expressions reference enum values autofilled by
+    // resolveInheritance, so lookupConstantExpressions needs a new traversal.
+    // Each of the passes below follows references between constant
+    // expressions itself, so it only requires earlier passes to have run on
+    // the constant expressions of the current type.
+    std::unordered_set<const ConstantExpression*> lookedUpCE;
+    std::unordered_set<const ConstantExpression*> acyclicCE;
+    std::unordered_set<const ConstantExpression*> acyclicStack;
+    std::unordered_set<const ConstantExpression*> validatedCE;
+    std::unordered_set<const ConstantExpression*> evaluatedCE;
+    passes.push_back([&](Type* type) { return lookupConstantExpressions(type, &lookedUpCE); });
+    if (!validated) {
+        // checkAcyclicConstantExpressions is after resolveInheritance,
+        // as resolveInheritance autofills enum values.
+        passes.push_back([&](Type* type) {
+            return checkAcyclicConstantExpressions(type, &acyclicCE, &acyclicStack);
+        });
+        passes.push_back(
+            [&](Type* type) { return validateConstantExpressions(type, &validatedCE); });
+    }
+    passes.push_back([&](Type* type) { return evaluateConstantExpressions(type, &evaluatedCE); });
+    err = runPasses("postParse: constantExpressions", Type::ParseStage::POST_PARSE, passes);
     if (err != OK) return err;
+    passes.clear();
 
+    // Type::validate may look at constant values anywhere in the file.
+    if (!validated) {
+        passes.push_back([](Type* type) { return type->validate(); });
+        passes.push_back([&](Type* type) { return checkForwardReferenceRestrictions(type); });
+    }
+    passes.push_back([&](Type* type) { return gatherReferencedTypes(type); });
     // Make future packages not to call passes
     // for processed types and expressions
-    constantExpressionRecursivePass(
-        [](ConstantExpression* ce) {
-            ce->setPostParseCompleted();
-            return OK;
-        },
-        true /* processBeforeDependencies */);
-
-    err = setParseStage(Type::ParseStage::POST_PARSE, Type::ParseStage::COMPLETED);
+    std::unordered_set<const ConstantExpression*> completedCE;
+    passes.push_back([&](Type* type) -> status_t {
+        status_t err = type->forEachConstantExpression([&](ConstantExpression* ce) {
+            return ce->recursivePass(
+                [](ConstantExpression* ce) {
+                    ce->setPostParseCompleted();
+                    return OK;
+                },
+                &completedCE, true /* processBeforeDependencies */);
+        });
+        if (err != OK) return err;
+        type->setParseStage(Type::ParseStage::COMPLETED);
+        return OK;
+    });
+    err = runPasses("postParse: validate", Type::ParseStage::POST_PARSE, passes);
     if (err != OK) return err;
 
+    // Lookups may have ignored an import which failed to parse.
+    if (mPendingImportFailed) return UNKNOWN_ERROR;
+
+    if (!validated && !validatedKey.empty()) {
+        mCoordinator->addToCache(validatedKey);
+    }
+
     return OK;
 }
 
-status_t AST::constantExpressionRecursivePass(
-    const std::function<status_t(ConstantExpression*)>& func, bool processBeforeDependencies) {
-    std::unordered_set<const Type*> visitedTypes;
-    std::unordered_set<const ConstantExpression*> visitedCE;
-    return mRootScope.recursivePass(Type::ParseStage::POST_PARSE,
-                                    [&](Type* type) -> status_t {
-                                        for (auto* ce : type->getConstantExpressions()) {
-                                            status_t err = ce->recursivePass(
-                                                func, &visitedCE, processBeforeDependencies);
-                                            if (err != OK) return err;
-                                        }
-                                        return OK;
-                                    },
-                                    &visitedTypes);
-}
-
-status_t AST::constantExpressionRecursivePass(
-    const std::function<status_t(const ConstantExpression*)>& func,
-    bool processBeforeDependencies) const {
-    std::unordered_set<const Type*> visitedTypes;
-    std::unordered_set<const ConstantExpression*> visitedCE;
-    return mRootScope.recursivePass(Type::ParseStage::POST_PARSE,
-                                    [&](const Type* type) -> status_t {
-                                        for (auto* ce : type->getConstantExpressions()) {
-                                            status_t err = ce->recursivePass(
-                                                func, &visitedCE, processBeforeDependencies);
-                                            if (err != OK) return err;
-                                        }
-                                        return OK;
-                                    },
-                                    &visitedTypes);
-}
-
-status_t AST::setParseStage(Type::ParseStage oldStage, Type::ParseStage newStage) {
-    std::unordered_set<const Type*> visited;
-    return mRootScope.recursivePass(oldStage,
-                                    [oldStage, newStage](Type* type) {
-                                        CHECK(type->getParseStage() == oldStage);
-                                        type->setParseStage(newStage);
-                                        return OK;
-                                    },
-                                    &visited);
-}
-
-status_t AST::lookupTypes() {
-    std::unordered_set<const Type*> visited;
-    return mRootScope.recursivePass(
-        Type::ParseStage::PARSE,
-        [&](Type* type) -> status_t {
-            Scope* scope = type->isScope() ? static_cast<Scope*>(type) : type->parent();
-
-            for (auto* nextRef : type->getReferences()) {
-                if (nextRef->isResolved()) {
-                    continue;
-                }
-
-                Type* nextType = lookupType(nextRef->getLookupFqName(), scope);
-                if (nextType == nullptr) {
-                    std::cerr << "ERROR: Failed to lookup type '"
-                              << nextRef->getLookupFqName().string() << "' at "
-                              << nextRef->location() << "\n";
-                    return UNKNOWN_ERROR;
-                }
-                nextRef->set(nextType);
-            }
+status_t AST::runPasses(const char* name, Type::ParseStage stage,
+                        const std::vector<TypePass>& passes) {
+    Profiler::Phase phase(name, getFilename());
+    std::vector<bool> visited(mNextPassIndex);
+    return mRootScope.recursivePasses(stage, passes, &visited, &mNextPassIndex);
+}
 
-            return OK;
-        },
-        &visited);
-}
-
-status_t AST::gatherReferencedTypes() {
-    std::unordered_set<const Type*> visited;
-    return mRootScope.recursivePass(
-        Type::ParseStage::POST_PARSE,
-        [&](Type* type) -> status_t {
-            for (auto* nextRef : type->getReferences()) {
-                const Type *targetType = nextRef->get();
-                if (targetType->isNamedType()) {
-                    mReferencedTypeNames.insert(
-                            static_cast<const NamedType *>(targetType)->fqName());
-                }
-            }
+status_t AST::lookupTypes(Type* type) {
+    Scope* scope = type->isScope() ? static_cast<Scope*>(type) : type->parent();
 
+    return type->forEachReference([&](Reference<Type>* nextRef) -> status_t {
+        if (nextRef->isResolved()) {
             return OK;
-        },
-        &visited);
-}
-
-status_t AST::lookupConstantExpressions() {
-    std::unordered_set<const Type*> visitedTypes;
-    std::unordered_set<const ConstantExpression*> visitedCE;
-
-    return mRootScope.recursivePass(
-        Type::ParseStage::POST_PARSE,
-        [&](Type* type) -> status_t {
-            Scope* scope = type->isScope() ? static_cast<Scope*>(type) : type->parent();
-
-            for (auto* ce : type->getConstantExpressions()) {
-                status_t err = ce->recursivePass(
-                    [&](ConstantExpression* ce) {
-                        for (auto* nextRef : ce->getReferences()) {
-                            if (nextRef->isResolved()) continue;
-
-                            LocalIdentifier* iden = lookupLocalIdentifier(*nextRef, scope);
-                            if (iden == nullptr) return UNKNOWN_ERROR;
-                            nextRef->set(iden);
-                        }
-                        for (auto* nextRef : ce->getTypeReferences()) {
-                            if (nextRef->isResolved()) continue;
-
-                            Type* nextType = lookupType(nextRef->getLookupFqName(), scope);
-                            if (nextType == nullptr) {
-                                std::cerr << "ERROR: Failed to lookup type '"
-                                          << nextRef->getLookupFqName().string() << "' at "
-                                          << nextRef->location() << "\n";
-                                return UNKNOWN_ERROR;
-                            }
-                            nextRef->set(nextType);
-                        }
-                        return OK;
-                    },
-                    &visitedCE, true /* processBeforeDependencies */);
-                if (err != OK) return err;
-            }
+        }
 
-            return OK;
-        },
-        &visitedTypes);
-}
-
-status_t AST::validateDefinedTypesUniqueNames() const {
-    std::unordered_set<const Type*> visited;
-    return mRootScope.recursivePass(
-        Type::ParseStage::POST_PARSE,
-        [&](const Type* type) -> status_t {
-            // We only want to validate type definition names in this place.
-            if (type->isScope()) {
-                return static_cast<const Scope*>(type)->validateUniqueNames();
-            }
-            return OK;
-        },
-        &visited);
+        Type* nextType = lookupType(nextRef->getLookupFqName(), scope);
+        if (nextType == nullptr) {
+            std::cerr << "ERROR: Failed to lookup type '"
+                      << nextRef->getLookupFqName().string() << "' at "
+                      << nextRef->location() << "\n";
+            return UNKNOWN_ERROR;
+        }
+        nextRef->set(nextType);
+        return OK;
+    });
 }
 
-status_t AST::resolveInheritance() {
-    std::unordered_set<const Type*> visited;
-    return mRootScope.recursivePass(Type::ParseStage::POST_PARSE, &Type::resolveInheritance,
-                                    &visited);
+status_t AST::gatherReferencedTypes(Type* type) {
+    return type->forEachReference([&](Reference<Type>* nextRef) {
+        const Type *targetType = nextRef->get();
+        if (targetType->isNamedType()) {
+            mReferencedTypeNames.insert(
+                    static_cast<const NamedType *>(targetType)->fqName());
+        }
+        return OK;
+    });
 }
 
-status_t AST::validateConstantExpressions() const {
-    return constantExpressionRecursivePass(
-        [](const ConstantExpression* ce) { return ce->validate(); },
-        true /* processBeforeDependencies */);
+status_t AST::lookupConstantExpressions(Type* type,
+                                        std::unordered_set<const ConstantExpression*>* visitedCE) {
+    Scope* scope = type->isScope() ? static_cast<Scope*>(type) : type->parent();
+
+    return type->forEachConstantExpression([&](ConstantExpression* ce) {
+        return ce->recursivePass(
+            [&](ConstantExpression* ce) {
+                status_t err = ce->forEachReference([&](Reference<LocalIdentifier>* nextRef) {
+                    if (nextRef->isResolved()) return OK;
+
+                    LocalIdentifier* iden = lookupLocalIdentifier(*nextRef, scope);
+                    if (iden == nullptr) return UNKNOWN_ERROR;
+                    nextRef->set(iden);
+                    return OK;
+                });
+                if (err != OK) return err;
+
+                return ce->forEachTypeReference([&](Reference<Type>* nextRef) -> status_t {
+                    if (nextRef->isResolved()) return OK;
+
+                    Type* nextType = lookupType(nextRef->getLookupFqName(), scope);
+                    if (nextType == nullptr) {
+                        std::cerr << "ERROR: Failed to lookup type '"
+                                  << nextRef->getLookupFqName().string() << "' at "
+                                  << nextRef->location() << "\n";
+                        return UNKNOWN_ERROR;
+                    }
+                    nextRef->set(nextType);
+                    return OK;
+                });
+            },
+            visitedCE, true /* processBeforeDependencies */);
+    });
+}
+
+status_t AST::validateDefinedTypesUniqueNames(const Type* type) const {
+    // We only want to validate type definition names in this place.
+    if (type->isScope()) {
+        return static_cast<const Scope*>(type)->validateUniqueNames();
+    }
+    return OK;
 }
 
-status_t AST::evaluateConstantExpressions() {
-    return constantExpressionRecursivePass(
-        [](ConstantExpression* ce) {
-            ce->evaluate();
-            return OK;
-        },
-        false /* processBeforeDependencies */);
+status_t AST::validateConstantExpressions(
+    const Type* type, std::unordered_set<const ConstantExpression*>* visitedCE) const {
+    return type->forEachConstantExpression([&](const ConstantExpression* ce) {
+        return ce->recursivePass([](const ConstantExpression* ce) { return ce->validate(); },
+                                 visitedCE, true /* processBeforeDependencies */);
+    });
 }
 
-status_t AST::validate() const {
-    std::unordered_set<const Type*> visited;
-    return mRootScope.recursivePass(Type::ParseStage::POST_PARSE, &Type::validate, &visited);
+status_t AST::evaluateConstantExpressions(
+    Type* type, std::unordered_set<const ConstantExpression*>* visitedCE) {
+    return type->forEachConstantExpression([&](ConstantExpression* ce) {
+        return ce->recursivePass(
+            [](ConstantExpression* ce) {
+                ce->evaluate();
+                return OK;
+            },
+            visitedCE, false /* processBeforeDependencies */);
+    });
 }
 
-status_t AST::topologicalReorder() {
-    std::unordered_map<const Type*, size_t> reversedOrder;
+status_t AST::topologicalOrder(std::unordered_map<const Type*, size_t>* reversedOrder) const {
     std::unordered_set<const Type*> stack;
-    status_t err = mRootScope.topologicalOrder(&reversedOrder, &stack).status;
-    if (err != OK) return err;
+    return mRootScope.topologicalOrder(reversedOrder, &stack).status;
+}
 
-    std::unordered_set<const Type*> visited;
-    mRootScope.recursivePass(Type::ParseStage::POST_PARSE,
-                             [&](Type* type) {
-                                 if (type->isScope()) {
-                                     static_cast<Scope*>(type)->topologicalReorder(reversedOrder);
-                                 }
-                                 return OK;
-                             },
-                             &visited);
+status_t AST::topologicalReorder(Type* type,
+                                 const std::unordered_map<const Type*, size_t>& reversedOrder) {
+    if (type->isScope()) {
+        static_cast<Scope*>(type)->topologicalReorder(reversedOrder);
+    }
     return OK;
 }
 
-status_t AST::checkAcyclicConstantExpressions() const {
-    std::unordered_set<const Type*> visitedTypes;
-    std::unordered_set<const ConstantExpression*> visitedCE;
-    std::unordered_set<const ConstantExpression*> stack;
-    return mRootScope.recursivePass(Type::ParseStage::POST_PARSE,
-                                    [&](const Type* type) -> status_t {
-                                        for (auto* ce : type->getConstantExpressions()) {
-                                            status_t err =
-                                                ce->checkAcyclic(&visitedCE, &stack).status;
-                                            CHECK(err != OK || stack.empty());
-                                            if (err != OK) return err;
-                                        }
-                                        return OK;
-                                    },
-                                    &visitedTypes);
-}
-
-status_t AST::checkForwardReferenceRestrictions() const {
-    std::unordered_set<const Type*> visited;
-    return mRootScope.recursivePass(Type::ParseStage::POST_PARSE,
-                                    [](const Type* type) -> status_t {
-                                        for (const Reference<Type>* ref : type->getReferences()) {
-                                            status_t err =
-                                                type->checkForwardReferenceRestrictions(*ref);
-                                            if (err != OK) return err;
-                                        }
-                                        return OK;
-                                    },
-                                    &visited);
+status_t AST::checkAcyclicConstantExpressions(
+    const Type* type, std::unordered_set<const ConstantExpression*>* visitedCE,
+    std::unordered_set<const ConstantExpression*>* stack) const {
+    return type->forEachConstantExpression([&](const ConstantExpression* ce) {
+        status_t err = ce->checkAcyclic(visitedCE, stack).status;
+        CHECK(err != OK || stack->empty());
+        return err;
+    });
+}
+
+status_t AST::checkForwardReferenceRestrictions(const Type* type) const {
+    return type->forEachReference([&](const Reference<Type>* ref) {
+        return type->checkForwardReferenceRestrictions(*ref);
+    });
 }
 
 bool AST::addImport(const char *import) {
+    mImportIndexValid = false;
+
     FQName fqName;
     if (!FQName::parse(import, &fqName)) {
         std::cerr << "ERROR: '" << import << "' is an invalid fully-qualified name." << std::endl;
@@ -386,6 +383,16 @@ bool AST::addImport(const char *import) {
         for (const auto &subFQName : packageInterfaces) {
             addToImportedNamesGranular(subFQName);
 
+            if (subFQName.name() != "types" && mCoordinator->parsesImportsLazily()) {
+                // Previous single type imports are ignored once it is parsed.
+                if (std::find(mPendingImports.begin(), mPendingImports.end(), subFQName) ==
+                    mPendingImports.end()) {
+                    mPendingImports.push_back(subFQName);
+                    mCoordinator->onPendingImport(false /* parsed */);
+                }
+                continue;
+            }
+
             // Do not enforce restrictions on imports.
             AST* ast = mCoordinator->parse(subFQName, &mImportedASTs, Coordinator::Enforce::NONE);
             if (ast == nullptr) {
@@ -413,6 +420,12 @@ bool AST::addImport(const char *import) {
     // importAST nullptr == file doesn't exist
 
     if (importAST != nullptr) {
+        // Its types are restricted by this import, even if its whole package
+        // was imported before.
+        mPendingImports.erase(
+            std::remove(mPendingImports.begin(), mPendingImports.end(), interfaceName),
+            mPendingImports.end());
+
         // cases like android.hardware.foo@1.0::IFoo.Internal
         //        and android.hardware.foo@1.0::IFoo
         if (fqName == interfaceName) {
@@ -460,6 +473,52 @@ bool AST::addImport(const char *import) {
 
 void AST::addImportedAST(AST *ast) {
     mImportedASTs.insert(ast);
+    mImportIndexValid = false;
+}
+
+const std::set<AST*>& AST::getImportedASTs() const {
+    return mImportedASTs;
+}
+
+const std::vector<FQName>& AST::getPendingImports() const {
+    return mPendingImports;
+}
+
+// Whether a type in the package of imported may be found by looking up
+// fqName, which may have a partial package, see buildImportIndex.
+static bool mayMatchPackage(const FQName& fqName, const FQName& imported) {
+    if (!fqName.version().empty() && fqName.version() != imported.version()) {
+        return false;
+    }
+    return fqName.package().empty() || fqName.package() == imported.package() ||
+           StringHelper::EndsWith(imported.package(), "." + fqName.package());
+}
+
+void AST::resolvePendingImports(const FQName* fqName) {
+    std::string localName;
+    if (fqName != nullptr) {
+        localName = fqName->name().substr(fqName->name().rfind('.') + 1);
+    }
+
+    for (auto it = mPendingImports.begin(); it != mPendingImports.end();) {
+        if (fqName != nullptr && (!mayMatchPackage(*fqName, *it) ||
+                                  !mCoordinator->mayDefineType(*it, localName))) {
+            it++;
+            continue;
+        }
+
+        // Do not enforce restrictions on imports.
+        AST* ast = mCoordinator->parse(*it, &mImportedASTs, Coordinator::Enforce::NONE);
+        if (ast == nullptr) {
+            mPendingImportFailed = true;
+        } else {
+            // all previous single type imports are ignored.
+            mImportedTypes.erase(ast);
+            mImportIndexValid = false;
+            mCoordinator->onPendingImport(true /* parsed */);
+        }
+        it = mPendingImports.erase(it);
+    }
 }
 
 FQName AST::makeFullName(const char* localName, Scope* scope) const {
@@ -604,63 +663,86 @@ status_t AST::lookupAutofilledType(const FQName &fqName, Type **returnedType) {
     return OK;
 }
 
-// Rule 2: look at imports
-Type *AST::lookupTypeFromImports(const FQName &fqName) {
+void AST::buildImportIndex() {
+    mImportIndex.clear();
 
-    Type *resolvedType = nullptr;
-    Type *returnedType = nullptr;
-    FQName resolvedName;
+    for (AST* importedAST : mImportedASTs) {
+        for (const auto& pair : importedAST->mDefinedTypesByFullName) {
+            const FQName& key = pair.first;
+            const std::string name = key.string();
 
-    for (const auto &importedAST : mImportedASTs) {
-        if (mImportedTypes.find(importedAST) != mImportedTypes.end()) {
-            // ignore single type imports
-            continue;
+            // Every suffix which FQName::endsWith accepts for this name.
+            for (size_t pos = 0; pos < name.size(); ++pos) {
+                if (pos != 0 && name[pos - 1] != '.' && name[pos - 1] != ':' &&
+                    name[pos] != '@') {
+                    continue;
+                }
+
+                // findDefinedType only returns the first match in each AST.
+                std::vector<ImportMatch>& matches = mImportIndex[name.substr(pos)];
+                if (matches.empty() || matches.back().ast != importedAST) {
+                    matches.push_back({importedAST, pair.second, key});
+                }
+            }
         }
-        FQName matchingName;
-        Type *match = importedAST->findDefinedType(fqName, &matchingName);
+    }
 
-        if (match != nullptr) {
-            if (resolvedType != nullptr) {
-                std::cerr << "ERROR: Unable to resolve type name '"
-                          << fqName.string()
-                          << "', multiple matches found:\n";
+    mImportIndexValid = true;
+}
 
-                std::cerr << "  " << resolvedName.string() << "\n";
-                std::cerr << "  " << matchingName.string() << "\n";
+const std::vector<AST::ImportMatch>* AST::lookupImportIndex(const FQName& fqName) {
+    resolvePendingImports(&fqName);
 
-                return nullptr;
-            }
+    if (!mImportIndexValid) {
+        buildImportIndex();
+    }
 
-            resolvedType = match;
-            returnedType = resolvedType;
-            resolvedName = matchingName;
+    auto it = mImportIndex.find(fqName.string());
+    mCoordinator->onImportLookup(it != mImportIndex.end());
+    if (it == mImportIndex.end()) {
+        return nullptr;
+    }
+    return &it->second;
+}
 
-            // Keep going even after finding a match.
-        }
+// Rule 2: look at imports
+Type *AST::lookupTypeFromImports(const FQName &fqName) {
+
+    Type *resolvedType = nullptr;
+    Type *returnedType = nullptr;
+    FQName resolvedName;
+
+    const std::vector<ImportMatch>* matches = lookupImportIndex(fqName);
+    if (matches == nullptr) {
+        return nullptr;
     }
 
-    for (const auto &pair : mImportedTypes) {
-        AST *importedAST = pair.first;
-        std::set<Type *> importedTypes = pair.second;
+    // Whole imported ASTs first, then single type imports.
+    for (bool singleTypeImports : {false, true}) {
+        for (const ImportMatch& match : *matches) {
+            auto importedTypes = mImportedTypes.find(match.ast);
+            if ((importedTypes != mImportedTypes.end()) != singleTypeImports) {
+                continue;
+            }
+            if (singleTypeImports &&
+                importedTypes->second.find(match.type) == importedTypes->second.end()) {
+                continue;
+            }
 
-        FQName matchingName;
-        Type *match = importedAST->findDefinedType(fqName, &matchingName);
-        if (match != nullptr &&
-                importedTypes.find(match) != importedTypes.end()) {
             if (resolvedType != nullptr) {
                 std::cerr << "ERROR: Unable to resolve type name '"
                           << fqName.string()
                           << "', multiple matches found:\n";
 
                 std::cerr << "  " << resolvedName.string() << "\n";
-                std::cerr << "  " << matchingName.string() << "\n";
+                std::cerr << "  " << match.matchingName.string() << "\n";
 
                 return nullptr;
             }
 
-            resolvedType = match;
+            resolvedType = match.type;
             returnedType = resolvedType;
-            resolvedName = matchingName;
+            resolvedName = match.matchingName;
 
             // Keep going even after finding a match.
         }
@@ -694,11 +776,12 @@ Type *AST::lookupTypeFromImports(const FQName &fqName) {
 
         if (!resolvedType->isInterface()) {
             FQName ifc = resolvedName.getTopLevelType();
-            for (const auto &importedAST : mImportedASTs) {
-                FQName matchingName;
-                Type *match = importedAST->findDefinedType(ifc, &matchingName);
-                if (match != nullptr && match->isInterface()) {
-                    resolvedType = match;
+            const std::vector<ImportMatch>* ifcMatches = lookupImportIndex(ifc);
+            if (ifcMatches != nullptr) {
+                for (const ImportMatch& match : *ifcMatches) {
+                    if (match.type->isInterface()) {
+                        resolvedType = match.type;
+                    }
                 }
             }
         }
@@ -762,16 +845,21 @@ void AST::getImportedPackages(std::set<FQName> *importSet) const {
     }
 }
 
-void AST::getImportedPackagesHierarchy(std::set<FQName> *importSet) const {
+status_t AST::getImportedPackagesHierarchy(std::set<FQName>* importSet) {
     getImportedPackages(importSet);
 
+    resolvePendingImports(nullptr /* fqName */);
+    if (mPendingImportFailed) return UNKNOWN_ERROR;
+
     std::set<FQName> newSet;
     for (const auto &ast : mImportedASTs) {
         if (importSet->find(ast->package()) != importSet->end()) {
-            ast->getImportedPackagesHierarchy(&newSet);
+            status_t err = ast->getImportedPackagesHierarchy(&newSet);
+            if (err != OK) return err;
         }
     }
     importSet->insert(newSet.begin(), newSet.end());
+    return OK;
 }
 
 void AST::getAllImportedNames(std::set<FQName> *allImportNames) const {
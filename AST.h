@@ -25,8 +25,11 @@
 #include <map>
 #include <set>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
+#include "Arena.h"
 #include "Scope.h"
 #include "Type.h"
 
@@ -62,6 +65,13 @@ struct AST {
 
     const std::string& getFilename() const;
     const Hash* getFileHash() const;
+    // Hash of this file in generated code, all zeros once it was found
+    // unfrozen while enforcing restrictions, see Coordinator::checkHash.
+    const std::vector<uint8_t>& getOutputHash() const;
+
+    // Hash of this file and of everything it (transitively) imports, set by
+    // postParse. Empty if there is no cache, see Coordinator::hasCache.
+    const std::string& getContentHash() const;
 
     // Look up local identifier.
     // It could be plain identifier or enum value as described by lookupEnumValue.
@@ -76,58 +86,61 @@ struct AST {
     Type* lookupType(const FQName& fqName, Scope* scope);
 
     void addImportedAST(AST *ast);
+    const std::set<AST*>& getImportedASTs() const;
+    // Interfaces imported with their whole package which were not parsed,
+    // since no lookup needed them (yet).
+    const std::vector<FQName>& getPendingImports() const;
 
     // Calls all passes after parsing required before
     // being ready to generate output.
     status_t postParse();
 
-    // Recursive pass on constant expression tree
-    status_t constantExpressionRecursivePass(
-        const std::function<status_t(ConstantExpression*)>& func, bool processBeforeDependencies);
-    status_t constantExpressionRecursivePass(
-        const std::function<status_t(const ConstantExpression*)>& func,
-        bool processBeforeDependencies) const;
+    // A pass which is run on each type, see runPasses.
+    using TypePass = std::function<status_t(Type*)>;
 
-    // Recursive tree pass that sets ParseStage of all types to newStage.
-    status_t setParseStage(Type::ParseStage oldStage, Type::ParseStage newStage);
+    // Visits each type in stage once, running all passes on it in order.
+    // The traversal is recorded as a phase called name, see Profiler.
+    status_t runPasses(const char* name, Type::ParseStage stage,
+                       const std::vector<TypePass>& passes);
 
-    // Recursive tree pass that looks up all referenced types
-    status_t lookupTypes();
+    // Type pass that looks up all referenced types
+    status_t lookupTypes(Type* type);
 
-    // Recursive tree pass that looks up all referenced local identifiers
+    // Type pass that looks up all referenced local identifiers
     // and types referenced by constant expressions
-    status_t lookupConstantExpressions();
+    status_t lookupConstantExpressions(Type* type,
+                                       std::unordered_set<const ConstantExpression*>* visitedCE);
 
-    // Recursive tree pass that validates that all defined types
+    // Type pass that validates that all defined types
     // have unique names in their scopes.
-    status_t validateDefinedTypesUniqueNames() const;
-
-    // Recursive tree pass that completes type declarations
-    // that depend on super types
-    status_t resolveInheritance();
+    status_t validateDefinedTypesUniqueNames(const Type* type) const;
 
-    // Recursive tree pass that validates constant expressions
-    status_t validateConstantExpressions() const;
+    // Type pass that validates constant expressions
+    status_t validateConstantExpressions(
+        const Type* type, std::unordered_set<const ConstantExpression*>* visitedCE) const;
 
-    // Recursive tree pass that evaluates constant expressions
-    status_t evaluateConstantExpressions();
+    // Type pass that evaluates constant expressions
+    status_t evaluateConstantExpressions(
+        Type* type, std::unordered_set<const ConstantExpression*>* visitedCE);
 
-    // Recursive tree pass that validates all type-related
-    // syntax restrictions
-    status_t validate() const;
+    // Ensures that type definitions and references are acyclic and
+    // computes their reversed topological order.
+    status_t topologicalOrder(std::unordered_map<const Type*, size_t>* reversedOrder) const;
 
-    // Recursive tree pass that ensures that type definitions and references
-    // are acyclic and reorderes type definitions in reversed topological order.
-    status_t topologicalReorder();
+    // Type pass that reorders type definitions in reversed topological order.
+    status_t topologicalReorder(Type* type,
+                                const std::unordered_map<const Type*, size_t>& reversedOrder);
 
-    // Recursive tree pass that ensures that constant expressions
+    // Type pass that ensures that constant expressions
     // are acyclic.
-    status_t checkAcyclicConstantExpressions() const;
+    status_t checkAcyclicConstantExpressions(
+        const Type* type, std::unordered_set<const ConstantExpression*>* visitedCE,
+        std::unordered_set<const ConstantExpression*>* stack) const;
 
-    // Recursive tree pass that checks C++ forward declaration restrictions.
-    status_t checkForwardReferenceRestrictions() const;
+    // Type pass that checks C++ forward declaration restrictions.
+    status_t checkForwardReferenceRestrictions(const Type* type) const;
 
-    status_t gatherReferencedTypes();
+    status_t gatherReferencedTypes(Type* type);
 
     void generateCppSource(Formatter& out) const;
 
@@ -143,6 +156,8 @@ struct AST {
     void generateCppAdapterHeader(Formatter& out) const;
     void generateCppAdapterSource(Formatter& out) const;
 
+    void generateCppDescriptorsHeader(Formatter& out) const;
+
     void generateJava(Formatter& out, const std::string& limitToType) const;
     void generateJavaTypes(Formatter& out, const std::string& limitToType) const;
 
@@ -153,8 +168,9 @@ struct AST {
     void getImportedPackages(std::set<FQName> *importSet) const;
 
     // Run getImportedPackages on this, then run getImportedPackages on
-    // each AST in each package referenced in importSet.
-    void getImportedPackagesHierarchy(std::set<FQName> *importSet) const;
+    // each AST in each package referenced in importSet. Parses all pending
+    // imports.
+    status_t getImportedPackagesHierarchy(std::set<FQName>* importSet);
 
     bool isJavaCompatible() const;
 
@@ -192,6 +208,13 @@ struct AST {
 
     Scope* getRootScope();
 
+    // Makes a node owned by this AST, used by the parser. It is destroyed
+    // together with the AST and must not be deleted on its own.
+    template <typename T, typename... Args>
+    T* make(Args&&... args) {
+        return mArena.make<T>(std::forward<Args>(args)...);
+    }
+
     static void generateCppPackageInclude(Formatter& out, const FQName& package,
                                           const std::string& klass);
 
@@ -203,6 +226,11 @@ struct AST {
    private:
     const Coordinator* mCoordinator;
     const Hash* mFileHash;
+    std::string mContentHash;
+
+    // Owns the nodes made by the parser, so it is declared before (and
+    // outlives) everything which may point into it.
+    Arena mArena;
 
     RootScope mRootScope;
 
@@ -212,10 +240,11 @@ struct AST {
     // in this AST, this is a subset of those specified in import statements.
     // Note that this set only resolves to the granularity of either an
     // interface type or a whole package.
+    // Ordered, since generated includes follow this order.
     std::set<FQName> mImportedNames;
 
     // This is the set of actually imported types.
-    std::set<FQName> mImportedNamesGranular;
+    std::unordered_set<FQName> mImportedNamesGranular;
 
     // Warning: this only includes names explicitly referenced in code.
     //   It does not include all names which are imported.
@@ -229,13 +258,46 @@ struct AST {
     // mImportedTypes, then the whole AST is imported.
     std::map<AST *, std::set<Type *>> mImportedTypes;
 
-    // Types keyed by full names defined in this AST.
+    // Interfaces imported with their whole package are only parsed (and
+    // added to mImportedASTs) once a lookup needs a name they may define, see
+    // resolvePendingImports. types.hal is always parsed.
+    std::vector<FQName> mPendingImports;
+    // A pending import could not be parsed once it was needed.
+    bool mPendingImportFailed = false;
+
+    // Parses the pending imports which may define a type whose local name is
+    // the last component of fqName, or all of them if fqName is nullptr.
+    void resolvePendingImports(const FQName* fqName);
+
+    // Types keyed by full names defined in this AST. Ordered, since
+    // findDefinedType returns the first match.
     std::map<FQName, Type *> mDefinedTypesByFullName;
 
+    struct ImportMatch {
+        AST* ast;
+        Type* type;
+        FQName matchingName;
+    };
+
+    // For every name (full or partial) which findDefinedType would resolve
+    // in one of mImportedASTs, the first match in each such AST, in the
+    // order of mImportedASTs. Rebuilt on the next lookup whenever imports
+    // change.
+    std::unordered_map<std::string, std::vector<ImportMatch>> mImportIndex;
+    bool mImportIndexValid = false;
+
+    void buildImportIndex();
+    const std::vector<ImportMatch>* lookupImportIndex(const FQName& fqName);
+
     // used by the parser.
     size_t mSyntaxErrors = 0;
 
-    std::set<FQName> mReferencedTypeNames;
+    // Number of pass indices handed out to types, see Type::recursivePasses.
+    size_t mNextPassIndex = 0;
+
+    std::unordered_set<FQName> mReferencedTypeNames;
+
+    void computeContentHash();
 
     // Helper functions for lookupType.
     Type* lookupTypeLocally(const FQName& fqName, Scope* scope);
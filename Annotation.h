@@ -43,8 +43,8 @@ struct AnnotationParam {
     /* Returns value interpretted as a boolean */
     bool getSingleBool() const;
 
-    std::vector<ConstantExpression*> getConstantExpressions();
-    virtual std::vector<const ConstantExpression*> getConstantExpressions() const;
+    virtual status_t forEachConstantExpression(
+        FunctionRef<status_t(const ConstantExpression*)> func) const;
 
    protected:
     const std::string mName;
@@ -69,7 +69,8 @@ struct ConstantExpressionAnnotationParam : AnnotationParam {
     std::vector<std::string> getValues() const override;
     std::string getSingleValue() const override;
 
-    std::vector<const ConstantExpression*> getConstantExpressions() const override;
+    status_t forEachConstantExpression(
+        FunctionRef<status_t(const ConstantExpression*)> func) const override;
 
    private:
     std::vector<ConstantExpression*>* const mValues;
@@ -84,8 +85,8 @@ struct Annotation {
     const AnnotationParamVector &params() const;
     const AnnotationParam *getParam(const std::string &name) const;
 
-    std::vector<ConstantExpression*> getConstantExpressions();
-    std::vector<const ConstantExpression*> getConstantExpressions() const;
+    status_t forEachConstantExpression(
+        FunctionRef<status_t(const ConstantExpression*)> func) const;
 
     void dump(Formatter &out) const;
 
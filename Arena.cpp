@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Arena.h"
+
+#include <stdint.h>
+
+namespace android {
+
+// Large enough for the nodes of a typical .hal file to fit in a few blocks.
+static constexpr size_t kBlockSize = 32 * 1024;
+
+Arena::~Arena() {
+    for (auto it = mDestructors.rbegin(); it != mDestructors.rend(); ++it) {
+        it->destroy(it->object);
+    }
+}
+
+size_t Arena::bytesAllocated() const {
+    return mBytesAllocated;
+}
+
+void* Arena::allocate(size_t size, size_t align) {
+    mBytesAllocated += size;
+
+    // Objects which would waste most of a block get one of their own.
+    if (size > kBlockSize / 4) {
+        mBlocks.emplace_back(new char[size]);
+        return mBlocks.back().get();
+    }
+
+    uintptr_t next = (reinterpret_cast<uintptr_t>(mNext) + align - 1) & ~(uintptr_t(align) - 1);
+    if (mNext == nullptr || next + size > reinterpret_cast<uintptr_t>(mEnd)) {
+        mBlocks.emplace_back(new char[kBlockSize]);
+        mNext = mBlocks.back().get();
+        mEnd = mNext + kBlockSize;
+        next = reinterpret_cast<uintptr_t>(mNext);
+    }
+
+    mNext = reinterpret_cast<char*>(next + size);
+    return reinterpret_cast<void*>(next);
+}
+
+}  // namespace android
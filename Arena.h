@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ARENA_H_
+
+#define ARENA_H_
+
+#include <android-base/macros.h>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace android {
+
+/**
+ * Bump allocator which owns every object made through it. Objects are laid
+ * out contiguously in large blocks and are all destroyed together, in reverse
+ * order of construction, when the arena is destroyed. Objects made by an
+ * arena must never be deleted individually.
+ */
+struct Arena {
+    Arena() = default;
+    ~Arena();
+
+    template <typename T, typename... Args>
+    T* make(Args&&... args) {
+        static_assert(alignof(T) <= alignof(std::max_align_t), "over-aligned type");
+
+        T* object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            mDestructors.push_back({object, &destroy<T>});
+        }
+        return object;
+    }
+
+    // Number of bytes handed out so far, excluding block slack.
+    size_t bytesAllocated() const;
+
+   private:
+    struct Destructor {
+        void* object;
+        void (*destroy)(void*);
+    };
+
+    template <typename T>
+    static void destroy(void* object) {
+        static_cast<T*>(object)->~T();
+    }
+
+    void* allocate(size_t size, size_t align);
+
+    std::vector<std::unique_ptr<char[]>> mBlocks;
+    std::vector<Destructor> mDestructors;
+    char* mNext = nullptr;
+    char* mEnd = nullptr;
+    size_t mBytesAllocated = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(Arena);
+};
+
+}  // namespace android
+
+#endif  // ARENA_H_
@@ -18,6 +18,7 @@
 
 #include <android-base/logging.h>
 #include <hidl-util/Formatter.h>
+#include <functional>
 #include <iostream>
 
 #include "ConstantExpression.h"
@@ -57,14 +58,16 @@ std::string ArrayType::typeName() const {
     return std::to_string(dimension()) + "d array of " + mElementType->typeName();
 }
 
-std::vector<const Reference<Type>*> ArrayType::getReferences() const {
-    return {&mElementType};
+status_t ArrayType::visitReferences(Visitor<const Reference<Type>*> func) const {
+    return func(&mElementType);
 }
 
-std::vector<const ConstantExpression*> ArrayType::getConstantExpressions() const {
-    std::vector<const ConstantExpression*> ret;
-    ret.insert(ret.end(), mSizes.begin(), mSizes.end());
-    return ret;
+status_t ArrayType::visitConstantExpressions(Visitor<const ConstantExpression*> func) const {
+    for (const auto* size : mSizes) {
+        status_t err = func(size);
+        if (err != OK) return err;
+    }
+    return OK;
 }
 
 status_t ArrayType::resolveInheritance() {
@@ -355,6 +358,50 @@ void ArrayType::emitJavaDump(
         << "));\n";
 }
 
+// Same format as toString(const hidl_array<T, SIZES...>&) in libhidl.
+void ArrayType::emitAppendToString(
+        Formatter &out,
+        size_t depth,
+        const std::string &streamName,
+        const std::string &name) const {
+    if (!hasAppendToString()) {
+        Type::emitAppendToString(out, depth, streamName, name);
+        return;
+    }
+
+    std::string sizes;
+    for (const auto* size : mSizes) {
+        sizes += "[" + std::to_string(size->castSizeT()) + "]";
+    }
+    out << "*" << streamName << " += \"" << sizes << "\";\n";
+
+    // One loop per dimension, e.x. name[_hidl_index_0][_hidl_index_1].
+    std::function<void(size_t, const std::string&)> emitDimension = [&](
+            size_t dim, const std::string& indexedName) {
+        if (dim == mSizes.size()) {
+            mElementType->emitAppendToString(out, depth + dim, streamName, indexedName);
+            return;
+        }
+
+        std::string iteratorName = "_hidl_index_" + std::to_string(depth + dim);
+
+        out << "*" << streamName << " += \"{\";\n";
+        out << "for (size_t " << iteratorName << " = 0; " << iteratorName << " < "
+            << mSizes[dim]->castSizeT() << "; ++" << iteratorName << ") ";
+        out.block([&] {
+            out.sIf(iteratorName + " > 0", [&] {
+                out << "*" << streamName << " += \", \";\n";
+            }).endl();
+            emitDimension(dim + 1, indexedName + "[" + iteratorName + "]");
+        }).endl();
+        out << "*" << streamName << " += \"}\";\n";
+    };
+    emitDimension(0, name);
+}
+
+bool ArrayType::hasAppendToString() const {
+    return mElementType->hasAppendToString();
+}
 
 bool ArrayType::needsEmbeddedReadWrite() const {
     return mElementType->needsEmbeddedReadWrite();
@@ -614,6 +661,18 @@ void ArrayType::getAlignmentAndSize(size_t *align, size_t *size) const {
     }
 }
 
+size_t ArrayType::getParcelDataSizeHint() const {
+    return kParcelBufferObjectSize + getEmbeddedParcelDataSizeHint();
+}
+
+size_t ArrayType::getEmbeddedParcelDataSizeHint() const {
+    size_t numArrayElements = 1;
+    for (auto size : mSizes) {
+        numArrayElements *= size->castSizeT();
+    }
+    return numArrayElements * mElementType->getEmbeddedParcelDataSizeHint();
+}
+
 size_t ArrayType::dimension() const {
     size_t numArrayElements = 1;
     for (auto size : mSizes) {
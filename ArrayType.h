@@ -40,9 +40,9 @@ struct ArrayType : public Type {
 
     std::string typeName() const override;
 
-    std::vector<const Reference<Type>*> getReferences() const override;
+    status_t visitReferences(Visitor<const Reference<Type>*> func) const override;
 
-    std::vector<const ConstantExpression*> getConstantExpressions() const override;
+    status_t visitConstantExpressions(Visitor<const ConstantExpression*> func) const override;
 
     // Extends existing array by adding another dimension.
     status_t resolveInheritance() override;
@@ -101,6 +101,14 @@ struct ArrayType : public Type {
             const std::string &parentName,
             const std::string &offsetText) const override;
 
+    void emitAppendToString(
+            Formatter &out,
+            size_t depth,
+            const std::string &streamName,
+            const std::string &name) const override;
+
+    bool hasAppendToString() const override;
+
     void emitJavaDump(
             Formatter &out,
             const std::string &streamName,
@@ -138,6 +146,9 @@ struct ArrayType : public Type {
 
     void getAlignmentAndSize(size_t *align, size_t *size) const override;
 
+    size_t getParcelDataSizeHint() const override;
+    size_t getEmbeddedParcelDataSizeHint() const override;
+
    private:
     Reference<Type> mElementType;
     std::vector<ConstantExpression*> mSizes;
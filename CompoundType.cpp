@@ -22,6 +22,8 @@
 
 #include <android-base/logging.h>
 #include <hidl-util/Formatter.h>
+#include <string.h>
+#include <algorithm>
 #include <iostream>
 #include <unordered_set>
 
@@ -39,10 +41,16 @@ void CompoundType::setFields(std::vector<NamedReference<Type>*>* fields) {
     mFields = fields;
 }
 
-std::vector<const Reference<Type>*> CompoundType::getReferences() const {
-    std::vector<const Reference<Type>*> ret;
-    ret.insert(ret.begin(), mFields->begin(), mFields->end());
-    return ret;
+const std::vector<NamedReference<Type>*>& CompoundType::getFields() const {
+    return *mFields;
+}
+
+status_t CompoundType::visitReferences(Visitor<const Reference<Type>*> func) const {
+    for (const auto* field : *mFields) {
+        status_t err = func(field);
+        if (err != OK) return err;
+    }
+    return OK;
 }
 
 status_t CompoundType::validate() const {
@@ -807,6 +815,10 @@ void CompoundType::emitPackageTypeDeclarations(Formatter& out) const {
         << getCppArgumentType()
         << (mFields->empty() ? "" : " o")
         << ");\n";
+    out << "static inline void appendToString(std::string* os, "
+        << getCppArgumentType()
+        << (mFields->empty() ? "" : " o")
+        << ");\n";
 
     if (canCheckEquality()) {
         out << "static inline bool operator==("
@@ -824,16 +836,15 @@ void CompoundType::emitPackageTypeDeclarations(Formatter& out) const {
 void CompoundType::emitPackageTypeHeaderDefinitions(Formatter& out) const {
     Scope::emitPackageTypeHeaderDefinitions(out);
 
-    out << "static inline std::string toString("
+    out << "static inline void appendToString(std::string* os, "
         << getCppArgumentType()
         << (mFields->empty() ? "" : " o")
         << ") ";
 
     out.block([&] {
         // include toString for scalar types
-        out << "using ::android::hardware::toString;\n"
-            << "std::string os;\n";
-        out << "os += \"{\";\n";
+        out << "using ::android::hardware::toString;\n";
+        out << "*os += \"{\";\n";
 
         if (mStyle == STYLE_SAFE_UNION) {
             out << "\nswitch (o.getDiscriminator()) {\n";
@@ -849,21 +860,26 @@ void CompoundType::emitPackageTypeHeaderDefinitions(Formatter& out) const {
                     << ": ";
 
                 out.block([&] {
-                    out << "os += \"."
-                    << field->name()
-                    << " = \";\n"
-                    << "os += toString(o."
-                    << field->name()
-                    << "());\n"
-                    << "break;\n";
+                    out << "*os += \"."
+                        << field->name()
+                        << " = \";\n";
+                    if (field->type().hasAppendToString()) {
+                        field->type().emitAppendToString(out, 0 /* depth */, "os",
+                                                         "o." + field->name() + "()");
+                    } else {
+                        out << "*os += toString(o."
+                            << field->name()
+                            << "());\n";
+                    }
+                    out << "break;\n";
                 }).endl();
             } else {
-                out << "os += \"";
+                out << "*os += \"";
                 if (field != *(mFields->begin())) {
                     out << ", ";
                 }
                 out << "." << field->name() << " = \";\n";
-                field->type().emitDump(out, "os", "o." + field->name());
+                field->type().emitAppendToString(out, 0 /* depth */, "os", "o." + field->name());
             }
         }
 
@@ -878,7 +894,23 @@ void CompoundType::emitPackageTypeHeaderDefinitions(Formatter& out) const {
             out.unindent();
             out << "}\n";
         }
-        out << "os += \"}\"; return os;\n";
+        out << "*os += \"}\";\n";
+    }).endl().endl();
+
+    // Room for the punctuation, the field names and short values, so that
+    // most structs are built without reallocating.
+    size_t stringSize = strlen("{}");
+    for (const NamedReference<Type>* field : *mFields) {
+        stringSize += strlen(", . = ") + field->name().size() + 16;
+    }
+
+    out << "static inline std::string toString(" << getCppArgumentType() << " o) ";
+
+    out.block([&] {
+        out << "std::string os;\n"
+            << "os.reserve(" << stringSize << ");\n"
+            << "appendToString(&os, o);\n"
+            << "return os;\n";
     }).endl().endl();
 
     if (canCheckEquality()) {
@@ -2059,6 +2091,18 @@ void CompoundType::emitResolveReferenceDef(Formatter& out, const std::string& pr
     out << "}\n\n";
 }
 
+void CompoundType::emitAppendToString(
+        Formatter &out,
+        size_t /* depth */,
+        const std::string &streamName,
+        const std::string &name) const {
+    out << fqName().cppNamespace() << "::appendToString(" << streamName << ", " << name << ");\n";
+}
+
+bool CompoundType::hasAppendToString() const {
+    return true;
+}
+
 bool CompoundType::needsEmbeddedReadWrite() const {
     if (mStyle == STYLE_UNION) {
         return false;
@@ -2190,6 +2234,54 @@ void CompoundType::getAlignmentAndSize(size_t *align, size_t *size) const {
     *size = layout.overall.size;
 }
 
+size_t CompoundType::getParcelDataSizeHint() const {
+    return kParcelBufferObjectSize + getEmbeddedParcelDataSizeHint();
+}
+
+size_t CompoundType::getEmbeddedParcelDataSizeHint() const {
+    // Only one field of a union is written.
+    const bool isUnion = mStyle != STYLE_STRUCT;
+
+    size_t size = 0;
+    for (const NamedReference<Type>* field : *mFields) {
+        const size_t fieldSize = field->type().getEmbeddedParcelDataSizeHint();
+        size = isUnion ? std::max(size, fieldSize) : size + fieldSize;
+    }
+    return size;
+}
+
+void CompoundType::appendParcelDataSizeHintTerms(
+        const std::string &name, std::vector<std::string> *terms) const {
+    if (mStyle != STYLE_STRUCT) {
+        return;
+    }
+
+    for (const NamedReference<Type>* field : *mFields) {
+        field->type().appendParcelDataSizeHintTerms(name + "." + field->name(), terms);
+    }
+}
+
+std::vector<size_t> CompoundType::getFieldOffsets() const {
+    // Fields of unions all start at the beginning of the inner struct.
+    const size_t innerStructOffset = getCompoundAlignmentAndSize().innerStruct.offset;
+
+    std::vector<size_t> offsets;
+    size_t size = 0;
+    for (const auto& field : *mFields) {
+        if (mStyle != STYLE_STRUCT) {
+            offsets.push_back(innerStructOffset);
+            continue;
+        }
+
+        size_t fieldAlign, fieldSize;
+        field->type().getAlignmentAndSize(&fieldAlign, &fieldSize);
+        size += Layout::getPad(size, fieldAlign);
+        offsets.push_back(innerStructOffset + size);
+        size += fieldSize;
+    }
+    return offsets;
+}
+
 CompoundType::CompoundLayout CompoundType::getCompoundAlignmentAndSize() const {
     CompoundLayout compoundLayout;
 
@@ -38,6 +38,10 @@ struct CompoundType : public Scope {
     Style style() const;
 
     void setFields(std::vector<NamedReference<Type>*>* fields);
+    const std::vector<NamedReference<Type>*>& getFields() const;
+
+    // Offsets of the fields in the C++ type, in the order of getFields.
+    std::vector<size_t> getFieldOffsets() const;
 
     bool isCompoundType() const override;
 
@@ -45,7 +49,7 @@ struct CompoundType : public Scope {
 
     std::string typeName() const override;
 
-    std::vector<const Reference<Type>*> getReferences() const override;
+    status_t visitReferences(Visitor<const Reference<Type>*> func) const override;
 
     status_t validate() const override;
     status_t validateUniqueNames() const;
@@ -132,6 +136,14 @@ struct CompoundType : public Scope {
 
     void emitJavaTypeDeclarations(Formatter& out, bool atTopLevel) const override;
 
+    void emitAppendToString(
+            Formatter &out,
+            size_t depth,
+            const std::string &streamName,
+            const std::string &name) const override;
+
+    bool hasAppendToString() const override;
+
     bool needsEmbeddedReadWrite() const override;
     bool deepNeedsResolveReferences(std::unordered_set<const Type*>* visited) const override;
     bool resultNeedsDeref() const override;
@@ -144,6 +156,11 @@ struct CompoundType : public Scope {
 
     void getAlignmentAndSize(size_t *align, size_t *size) const override;
 
+    size_t getParcelDataSizeHint() const override;
+    size_t getEmbeddedParcelDataSizeHint() const override;
+    void appendParcelDataSizeHintTerms(
+            const std::string &name, std::vector<std::string> *terms) const override;
+
     bool containsInterface() const;
 private:
 
@@ -515,36 +515,44 @@ status_t ConstantExpression::validate() const {
     return OK;
 }
 
-std::vector<ConstantExpression*> ConstantExpression::getConstantExpressions() {
-    const auto& constRet = static_cast<const ConstantExpression*>(this)->getConstantExpressions();
-    std::vector<ConstantExpression*> ret(constRet.size());
-    std::transform(constRet.begin(), constRet.end(), ret.begin(),
-                   [](const auto* ce) { return const_cast<ConstantExpression*>(ce); });
-    return ret;
+status_t ConstantExpression::forEachConstantExpression(Visitor<ConstantExpression*> func) {
+    return visitConstantExpressions(
+        [&](const ConstantExpression* ce) { return func(const_cast<ConstantExpression*>(ce)); });
 }
 
-std::vector<Reference<LocalIdentifier>*> ConstantExpression::getReferences() {
-    const auto& constRet = static_cast<const ConstantExpression*>(this)->getReferences();
-    std::vector<Reference<LocalIdentifier>*> ret(constRet.size());
-    std::transform(constRet.begin(), constRet.end(), ret.begin(),
-                   [](const auto* ce) { return const_cast<Reference<LocalIdentifier>*>(ce); });
-    return ret;
+status_t ConstantExpression::forEachConstantExpression(
+    Visitor<const ConstantExpression*> func) const {
+    return visitConstantExpressions(func);
 }
 
-std::vector<const Reference<LocalIdentifier>*> ConstantExpression::getReferences() const {
-    return {};
+status_t ConstantExpression::forEachReference(Visitor<Reference<LocalIdentifier>*> func) {
+    return visitReferences([&](const Reference<LocalIdentifier>* ref) {
+        return func(const_cast<Reference<LocalIdentifier>*>(ref));
+    });
 }
 
-std::vector<Reference<Type>*> ConstantExpression::getTypeReferences() {
-    const auto& constRet = static_cast<const ConstantExpression*>(this)->getTypeReferences();
-    std::vector<Reference<Type>*> ret(constRet.size());
-    std::transform(constRet.begin(), constRet.end(), ret.begin(),
-                   [](const auto* ce) { return const_cast<Reference<Type>*>(ce); });
-    return ret;
+status_t ConstantExpression::forEachReference(
+    Visitor<const Reference<LocalIdentifier>*> func) const {
+    return visitReferences(func);
+}
+
+status_t ConstantExpression::visitReferences(
+    Visitor<const Reference<LocalIdentifier>*> /* func */) const {
+    return OK;
+}
+
+status_t ConstantExpression::forEachTypeReference(Visitor<Reference<Type>*> func) {
+    return visitTypeReferences(
+        [&](const Reference<Type>* ref) { return func(const_cast<Reference<Type>*>(ref)); });
+}
+
+status_t ConstantExpression::forEachTypeReference(Visitor<const Reference<Type>*> func) const {
+    return visitTypeReferences(func);
 }
 
-std::vector<const Reference<Type>*> ConstantExpression::getTypeReferences() const {
-    return {};
+status_t ConstantExpression::visitTypeReferences(
+    Visitor<const Reference<Type>*> /* func */) const {
+    return OK;
 }
 
 status_t ConstantExpression::recursivePass(const std::function<status_t(ConstantExpression*)>& func,
@@ -560,20 +568,20 @@ status_t ConstantExpression::recursivePass(const std::function<status_t(Constant
         if (err != OK) return err;
     }
 
-    for (auto* nextCE : getConstantExpressions()) {
-        status_t err = nextCE->recursivePass(func, visited, processBeforeDependencies);
-        if (err != OK) return err;
-    }
+    status_t err = forEachConstantExpression([&](ConstantExpression* nextCE) {
+        return nextCE->recursivePass(func, visited, processBeforeDependencies);
+    });
+    if (err != OK) return err;
 
-    for (auto* nextRef : getReferences()) {
+    err = forEachReference([&](Reference<LocalIdentifier>* nextRef) {
         auto* nextCE = nextRef->shallowGet()->constExpr();
         CHECK(nextCE != nullptr) << "Local identifier is not a constant expression";
-        status_t err = nextCE->recursivePass(func, visited, processBeforeDependencies);
-        if (err != OK) return err;
-    }
+        return nextCE->recursivePass(func, visited, processBeforeDependencies);
+    });
+    if (err != OK) return err;
 
     if (!processBeforeDependencies) {
-        status_t err = func(this);
+        err = func(this);
         if (err != OK) return err;
     }
 
@@ -593,20 +601,20 @@ status_t ConstantExpression::recursivePass(
         if (err != OK) return err;
     }
 
-    for (const auto* nextCE : getConstantExpressions()) {
-        status_t err = nextCE->recursivePass(func, visited, processBeforeDependencies);
-        if (err != OK) return err;
-    }
+    status_t err = forEachConstantExpression([&](const ConstantExpression* nextCE) {
+        return nextCE->recursivePass(func, visited, processBeforeDependencies);
+    });
+    if (err != OK) return err;
 
-    for (const auto* nextRef : getReferences()) {
+    err = forEachReference([&](const Reference<LocalIdentifier>* nextRef) {
         const auto* nextCE = nextRef->shallowGet()->constExpr();
         CHECK(nextCE != nullptr) << "Local identifier is not a constant expression";
-        status_t err = nextCE->recursivePass(func, visited, processBeforeDependencies);
-        if (err != OK) return err;
-    }
+        return nextCE->recursivePass(func, visited, processBeforeDependencies);
+    });
+    if (err != OK) return err;
 
     if (!processBeforeDependencies) {
-        status_t err = func(this);
+        err = func(this);
         if (err != OK) return err;
     }
 
@@ -637,20 +645,25 @@ ConstantExpression::CheckAcyclicStatus ConstantExpression::checkAcyclic(
     visited->insert(this);
     stack->insert(this);
 
-    for (const auto* nextCE : getConstantExpressions()) {
-        auto err = nextCE->checkAcyclic(visited, stack);
-        if (err.status != OK) {
-            return err;
-        }
-    }
+    // The status of a failed operand, returned once iteration stopped.
+    CheckAcyclicStatus result(OK);
 
-    for (const auto* nextRef : getReferences()) {
+    forEachConstantExpression([&](const ConstantExpression* nextCE) {
+        result = nextCE->checkAcyclic(visited, stack);
+        return result.status;
+    });
+    if (result.status != OK) return result;
+
+    forEachReference([&](const Reference<LocalIdentifier>* nextRef) -> status_t {
         const auto* nextCE = nextRef->shallowGet()->constExpr();
         CHECK(nextCE != nullptr) << "Local identifier is not a constant expression";
         auto err = nextCE->checkAcyclic(visited, stack);
 
         if (err.status != OK) {
-            if (err.cycleEnd == nullptr) return err;
+            if (err.cycleEnd == nullptr) {
+                result = err;
+                return err.status;
+            }
 
             // Only ReferenceConstantExpression has references,
             CHECK(isReferenceConstantExpression())
@@ -661,12 +674,16 @@ ConstantExpression::CheckAcyclicStatus ConstantExpression::checkAcyclic(
                       << nextRef->location() << "\n";
 
             if (err.cycleEnd == this) {
-                return CheckAcyclicStatus(err.status);
+                result = CheckAcyclicStatus(err.status);
+            } else {
+                result = CheckAcyclicStatus(err.status, err.cycleEnd,
+                                            static_cast<const ReferenceConstantExpression*>(this));
             }
-            return CheckAcyclicStatus(err.status, err.cycleEnd,
-                                      static_cast<const ReferenceConstantExpression*>(this));
+            return err.status;
         }
-    }
+        return OK;
+    });
+    if (result.status != OK) return result;
 
     CHECK(stack->find(this) != stack->end());
     stack->erase(this);
@@ -678,23 +695,28 @@ void ConstantExpression::setPostParseCompleted() {
     mIsPostParseCompleted = true;
 }
 
-std::vector<const ConstantExpression*> LiteralConstantExpression::getConstantExpressions() const {
-    return {};
+status_t LiteralConstantExpression::visitConstantExpressions(
+    Visitor<const ConstantExpression*> /* func */) const {
+    return OK;
 }
 
 UnaryConstantExpression::UnaryConstantExpression(const std::string& op, ConstantExpression* value)
     : mUnary(value), mOp(op) {}
 
-std::vector<const ConstantExpression*> UnaryConstantExpression::getConstantExpressions() const {
-    return {mUnary};
+status_t UnaryConstantExpression::visitConstantExpressions(
+    Visitor<const ConstantExpression*> func) const {
+    return func(mUnary);
 }
 
 BinaryConstantExpression::BinaryConstantExpression(ConstantExpression* lval, const std::string& op,
                                                    ConstantExpression* rval)
     : mLval(lval), mRval(rval), mOp(op) {}
 
-std::vector<const ConstantExpression*> BinaryConstantExpression::getConstantExpressions() const {
-    return {mLval, mRval};
+status_t BinaryConstantExpression::visitConstantExpressions(
+    Visitor<const ConstantExpression*> func) const {
+    status_t err = func(mLval);
+    if (err != OK) return err;
+    return func(mRval);
 }
 
 TernaryConstantExpression::TernaryConstantExpression(ConstantExpression* cond,
@@ -702,8 +724,13 @@ TernaryConstantExpression::TernaryConstantExpression(ConstantExpression* cond,
                                                      ConstantExpression* falseVal)
     : mCond(cond), mTrueVal(trueVal), mFalseVal(falseVal) {}
 
-std::vector<const ConstantExpression*> TernaryConstantExpression::getConstantExpressions() const {
-    return {mCond, mTrueVal, mFalseVal};
+status_t TernaryConstantExpression::visitConstantExpressions(
+    Visitor<const ConstantExpression*> func) const {
+    for (const ConstantExpression* ce : {mCond, mTrueVal, mFalseVal}) {
+        status_t err = func(ce);
+        if (err != OK) return err;
+    }
+    return OK;
 }
 
 ReferenceConstantExpression::ReferenceConstantExpression(const Reference<LocalIdentifier>& value,
@@ -717,13 +744,15 @@ bool ReferenceConstantExpression::isReferenceConstantExpression() const {
     return true;
 }
 
-std::vector<const ConstantExpression*> ReferenceConstantExpression::getConstantExpressions() const {
-    // Returns reference instead
-    return {};
+status_t ReferenceConstantExpression::visitConstantExpressions(
+    Visitor<const ConstantExpression*> /* func */) const {
+    // Visits reference instead
+    return OK;
 }
 
-std::vector<const Reference<LocalIdentifier>*> ReferenceConstantExpression::getReferences() const {
-    return {&mReference};
+status_t ReferenceConstantExpression::visitReferences(
+    Visitor<const Reference<LocalIdentifier>*> func) const {
+    return func(&mReference);
 }
 
 AttributeConstantExpression::AttributeConstantExpression(const Reference<Type>& value,
@@ -733,13 +762,15 @@ AttributeConstantExpression::AttributeConstantExpression(const Reference<Type>&
     mExpr = fqname + "#" + tag;
 }
 
-std::vector<const ConstantExpression*> AttributeConstantExpression::getConstantExpressions() const {
-    // Returns reference instead
-    return {};
+status_t AttributeConstantExpression::visitConstantExpressions(
+    Visitor<const ConstantExpression*> /* func */) const {
+    // Visits reference instead
+    return OK;
 }
 
-std::vector<const Reference<Type>*> AttributeConstantExpression::getTypeReferences() const {
-    return {&mReference};
+status_t AttributeConstantExpression::visitTypeReferences(
+    Visitor<const Reference<Type>*> func) const {
+    return func(&mReference);
 }
 
 /*
@@ -25,6 +25,7 @@
 #include <unordered_set>
 #include <vector>
 
+#include "FunctionRef.h"
 #include "Reference.h"
 #include "ScalarType.h"
 
@@ -67,14 +68,21 @@ struct ConstantExpression {
     // Doesn't call recursive evaluation, so must be called after dependencies
     virtual void evaluate() = 0;
 
-    std::vector<ConstantExpression*> getConstantExpressions();
-    virtual std::vector<const ConstantExpression*> getConstantExpressions() const = 0;
+    // Callbacks for the forEach functions below, see Type::Visitor.
+    template <typename T>
+    using Visitor = FunctionRef<status_t(T)>;
+
+    // Operands of this expression.
+    status_t forEachConstantExpression(Visitor<ConstantExpression*> func);
+    status_t forEachConstantExpression(Visitor<const ConstantExpression*> func) const;
 
-    std::vector<Reference<LocalIdentifier>*> getReferences();
-    virtual std::vector<const Reference<LocalIdentifier>*> getReferences() const;
+    // Identifiers this expression refers to.
+    status_t forEachReference(Visitor<Reference<LocalIdentifier>*> func);
+    status_t forEachReference(Visitor<const Reference<LocalIdentifier>*> func) const;
 
-    std::vector<Reference<Type>*> getTypeReferences();
-    virtual std::vector<const Reference<Type>*> getTypeReferences() const;
+    // Types this expression refers to.
+    status_t forEachTypeReference(Visitor<Reference<Type>*> func);
+    status_t forEachTypeReference(Visitor<const Reference<Type>*> func) const;
 
     // Recursive tree pass checkAcyclic return type.
     // Stores cycle end for nice error messages.
@@ -132,6 +140,12 @@ struct ConstantExpression {
     std::string rawValue() const;
     std::string rawValue(ScalarType::Kind castKind) const;
 
+   protected:
+    // Implementations of the forEach functions.
+    virtual status_t visitConstantExpressions(Visitor<const ConstantExpression*> func) const = 0;
+    virtual status_t visitReferences(Visitor<const Reference<LocalIdentifier>*> func) const;
+    virtual status_t visitTypeReferences(Visitor<const Reference<Type>*> func) const;
+
    private:
     /* If the result value has been evaluated. */
     bool mIsEvaluated = false;
@@ -171,7 +185,7 @@ struct LiteralConstantExpression : public ConstantExpression {
     LiteralConstantExpression(ScalarType::Kind kind, uint64_t value);
     LiteralConstantExpression(ScalarType::Kind kind, uint64_t value, const std::string& expr);
     void evaluate() override;
-    std::vector<const ConstantExpression*> getConstantExpressions() const override;
+    status_t visitConstantExpressions(Visitor<const ConstantExpression*> func) const override;
 
     static LiteralConstantExpression* tryParse(const std::string& value);
 };
@@ -179,7 +193,7 @@ struct LiteralConstantExpression : public ConstantExpression {
 struct UnaryConstantExpression : public ConstantExpression {
     UnaryConstantExpression(const std::string& mOp, ConstantExpression* value);
     void evaluate() override;
-    std::vector<const ConstantExpression*> getConstantExpressions() const override;
+    status_t visitConstantExpressions(Visitor<const ConstantExpression*> func) const override;
 
    private:
     ConstantExpression* const mUnary;
@@ -190,7 +204,7 @@ struct BinaryConstantExpression : public ConstantExpression {
     BinaryConstantExpression(ConstantExpression* lval, const std::string& op,
                              ConstantExpression* rval);
     void evaluate() override;
-    std::vector<const ConstantExpression*> getConstantExpressions() const override;
+    status_t visitConstantExpressions(Visitor<const ConstantExpression*> func) const override;
 
    private:
     ConstantExpression* const mLval;
@@ -202,7 +216,7 @@ struct TernaryConstantExpression : public ConstantExpression {
     TernaryConstantExpression(ConstantExpression* cond, ConstantExpression* trueVal,
                               ConstantExpression* falseVal);
     void evaluate() override;
-    std::vector<const ConstantExpression*> getConstantExpressions() const override;
+    status_t visitConstantExpressions(Visitor<const ConstantExpression*> func) const override;
 
    private:
     ConstantExpression* const mCond;
@@ -215,8 +229,8 @@ struct ReferenceConstantExpression : public ConstantExpression {
 
     bool isReferenceConstantExpression() const override;
     void evaluate() override;
-    std::vector<const ConstantExpression*> getConstantExpressions() const override;
-    std::vector<const Reference<LocalIdentifier>*> getReferences() const override;
+    status_t visitConstantExpressions(Visitor<const ConstantExpression*> func) const override;
+    status_t visitReferences(Visitor<const Reference<LocalIdentifier>*> func) const override;
 
    private:
     Reference<LocalIdentifier> mReference;
@@ -230,8 +244,8 @@ struct AttributeConstantExpression : public ConstantExpression {
     status_t validate() const override;
     void evaluate() override;
 
-    std::vector<const ConstantExpression*> getConstantExpressions() const override;
-    std::vector<const Reference<Type>*> getTypeReferences() const override;
+    status_t visitConstantExpressions(Visitor<const ConstantExpression*> func) const override;
+    status_t visitTypeReferences(Visitor<const Reference<Type>*> func) const override;
 
    private:
     Reference<Type> mReference;
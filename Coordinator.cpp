@@ -16,14 +16,22 @@
 
 #include "Coordinator.h"
 
+#include <ctype.h>
 #include <dirent.h>
+#include <fcntl.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
 #include <algorithm>
+#include <atomic>
+#include <fstream>
 #include <iterator>
+#include <thread>
 
+#include <android-base/file.h>
 #include <android-base/logging.h>
 #include <hidl-hash/Hash.h>
+#include <hidl-util/Profiler.h>
 #include <hidl-util/StringHelper.h>
 #include <iostream>
 
@@ -31,15 +39,6 @@
 #include "Interface.h"
 #include "hidl-gen_l.h"
 
-static bool existdir(const char *name) {
-    DIR *dir = opendir(name);
-    if (dir == nullptr) {
-        return false;
-    }
-    closedir(dir);
-    return true;
-}
-
 namespace android {
 
 const std::string &Coordinator::getRootPath() const {
@@ -70,6 +69,382 @@ void Coordinator::setDepFile(const std::string& depFile) {
     mDepFile = depFile;
 }
 
+bool Coordinator::hasDepFile() const {
+    return !mDepFile.empty();
+}
+
+void Coordinator::setCacheDir(const std::string& cacheDir) {
+    mCacheDir = cacheDir;
+
+    if (!mCacheDir.empty() && !StringHelper::EndsWith(mCacheDir, "/")) {
+        mCacheDir += "/";
+    }
+}
+
+bool Coordinator::hasCache() const {
+    return !mCacheDir.empty() && !getToolHash().empty();
+}
+
+bool Coordinator::isCached(const std::string& key) const {
+    if (!hasCache()) return false;
+
+    const bool cached = access((mCacheDir + key).c_str(), F_OK) == 0;
+
+    if (mVerbose) {
+        fprintf(stderr, "VERBOSE: cache %s %s\n", cached ? "hit" : "miss", key.c_str());
+    }
+    return cached;
+}
+
+void Coordinator::addToCache(const std::string& key) const {
+    if (!hasCache()) return;
+
+    // Entries are empty files, creating one is atomic with respect to other
+    // hidl-gen processes sharing the directory.
+    const std::string path = mCacheDir + key;
+    if (!makeParentHierarchy(path)) {
+        fprintf(stderr, "WARNING: could not make cache directory %s.\n", mCacheDir.c_str());
+        return;
+    }
+
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "WARNING: could not write to cache %s: %d\n", path.c_str(), errno);
+        return;
+    }
+    close(fd);
+}
+
+// Names of the .hal files in dir at path, without extension, types first.
+static status_t listPackageDirectory(DIR* dir, const std::string& path,
+                                     std::vector<std::string>* listing) {
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != nullptr) {
+        // filesystems may not support d_type and return DT_UNKNOWN
+        if (ent->d_type == DT_UNKNOWN) {
+            struct stat sb;
+            const auto filename = path + std::string(ent->d_name);
+            if (stat(filename.c_str(), &sb) == -1) {
+                fprintf(stderr, "ERROR: Could not stat %s\n", filename.c_str());
+                return -errno;
+            }
+            if ((sb.st_mode & S_IFMT) != S_IFREG) {
+                continue;
+            }
+        } else if (ent->d_type != DT_REG) {
+             continue;
+        }
+
+        const auto suffix = ".hal";
+        const auto suffix_len = std::strlen(suffix);
+        const auto d_namelen = strlen(ent->d_name);
+
+        if (d_namelen < suffix_len
+                || strcmp(ent->d_name + d_namelen - suffix_len, suffix)) {
+            continue;
+        }
+
+        listing->push_back(std::string(ent->d_name, d_namelen - suffix_len));
+    }
+
+    std::sort(listing->begin(), listing->end(),
+              [](const std::string& lhs, const std::string& rhs) -> bool {
+                  if (lhs == "types") {
+                      return true;
+                  }
+                  if (rhs == "types") {
+                      return false;
+                  }
+                  return lhs < rhs;
+              });
+
+    return OK;
+}
+
+// Bump whenever the format of output fingerprints changes.
+static const char* const kOutputsCacheVersion = "hidl-gen-outputs-2";
+
+static std::string hashListing(const std::vector<std::string>& listing) {
+    return Hash::hexString(Hash::sha256(StringHelper::JoinStrings(listing, "\n")));
+}
+
+// The code is the binary and its own libraries, found through /proc.
+const std::string& Coordinator::getToolHash() {
+    static const std::string toolHash = [] {
+        std::set<std::string> paths;
+        std::ifstream maps("/proc/self/maps");
+        std::string line;
+        while (std::getline(maps, line)) {
+            // The path is the last column of mappings of files.
+            const size_t pathStart = line.find('/');
+            if (pathStart == std::string::npos) continue;
+            const std::string path = line.substr(pathStart);
+            if (path.find("hidl-gen", path.rfind('/')) != std::string::npos) {
+                paths.insert(path);
+            }
+        }
+
+        if (paths.empty()) return std::string();
+
+        std::vector<std::string> parts;
+        for (const std::string& path : paths) {
+            parts.push_back(Hash::hexString(Hash::sha256File(path)) + " " + path);
+        }
+        return Hash::hexString(Hash::sha256(StringHelper::JoinStrings(parts, "\n")));
+    }();
+    return toolHash;
+}
+
+std::string Coordinator::getOutputsKey(const std::string& description) const {
+    if (!hasCache()) return "";
+
+    std::vector<std::string> parts = {kOutputsCacheVersion, getToolHash(), description,
+                                      mRootPath, mOutputPath, mOwner};
+    for (const PackageRoot& packageRoot : mPackageRoots) {
+        parts.push_back(packageRoot.root.string() + ":" + packageRoot.path);
+    }
+    return "outputs-" + Hash::hexString(Hash::sha256(StringHelper::JoinStrings(parts, "\n")));
+}
+
+// Ends every fingerprint, so that one which was cut short is not up to date.
+static const char* const kOutputsEnd = "end";
+
+bool Coordinator::areOutputsUpToDate(const std::string& key) const {
+    if (key.empty()) return false;
+
+    // Lines are "<kind> <hash> <path>", followed by kOutputsEnd, see
+    // recordOutputs.
+    std::string fingerprint;
+    bool upToDate = base::ReadFileToString(mCacheDir + key, &fingerprint);
+    std::vector<std::string> lines;
+    StringHelper::SplitString(fingerprint, '\n', &lines);
+    while (!lines.empty() && lines.back().empty()) lines.pop_back();
+    upToDate = upToDate && !lines.empty() && lines.back() == kOutputsEnd;
+    if (upToDate) lines.pop_back();
+
+    size_t outputs = 0;
+    for (const std::string& line : lines) {
+        if (!upToDate) break;
+
+        const size_t hashEnd = line.find(' ', line.find(' ') + 1);
+        if (hashEnd == std::string::npos) {
+            upToDate = false;
+            break;
+        }
+        const std::string kindAndHash = line.substr(0, hashEnd);
+        const std::string path = line.substr(hashEnd + 1);
+
+        if (StringHelper::StartsWith(kindAndHash, "dir ")) {
+            std::unique_ptr<DIR, decltype(&closedir)> dir(opendir(path.c_str()), closedir);
+            std::vector<std::string> listing;
+            upToDate = dir != nullptr && listPackageDirectory(dir.get(), path, &listing) == OK &&
+                       kindAndHash == "dir " + hashListing(listing);
+            continue;
+        }
+
+        upToDate = access(path.c_str(), F_OK) == 0;
+        if (upToDate && StringHelper::StartsWith(kindAndHash, "in ")) {
+            onFileAccess(path, "r");
+            upToDate = kindAndHash == "in " + Hash::hexString(Hash::sha256File(path));
+        } else if (upToDate) {
+            upToDate = kindAndHash == "out " + Hash::hexString(Hash::sha256File(path));
+            outputs++;
+        }
+    }
+    // Every fingerprint has outputs, see recordOutputs.
+    upToDate = upToDate && outputs > 0;
+
+    if (mVerbose) {
+        fprintf(stderr, "VERBOSE: outputs %s %s\n", upToDate ? "up to date" : "out of date",
+                key.c_str());
+    }
+    return upToDate;
+}
+
+void Coordinator::startRecordingInputs() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mRecordingInputs = true;
+    mInputFiles.clear();
+    mInputDirectories.clear();
+}
+
+void Coordinator::addInputsLocked(const AST* ast, std::set<const AST*>* visited) const {
+    if (!visited->insert(ast).second) return;
+
+    const std::string& path = ast->getFilename();
+    mInputFiles.insert(path);
+    mInputDirectories.insert(path.substr(0, path.rfind('/') + 1));
+
+    // Packages imported as a whole whose files were only scanned, see mayDefineType.
+    for (const FQName& fqName : ast->getPendingImports()) {
+        auto it = mFileIdentifiers.find(fqName);
+        if (it == mFileIdentifiers.end()) continue;
+        mInputFiles.insert(it->second.path);
+        mInputDirectories.insert(it->second.path.substr(0, it->second.path.rfind('/') + 1));
+    }
+
+    for (const AST* importedAST : ast->getImportedASTs()) {
+        addInputsLocked(importedAST, visited);
+    }
+}
+
+void Coordinator::recordOutputs(const std::string& key, const FQName& fqName,
+                                const std::vector<std::string>& outputFiles) const {
+    if (key.empty() || outputFiles.empty()) return;
+
+    std::vector<FQName> packageInterfaces;
+    if (appendPackageInterfacesToVector(fqName.getPackageAndVersion(), &packageInterfaces) !=
+        OK) {
+        return;
+    }
+
+    std::map<std::string, FileStamp> inputs;
+    std::vector<std::string> lines;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (!mRecordingInputs) return;
+        mRecordingInputs = false;
+
+        std::set<const AST*> visited;
+        for (const FQName& packageInterface : packageInterfaces) {
+            auto it = mCache.find(packageInterface);
+            if (it != mCache.end() && it->second != nullptr) {
+                addInputsLocked(it->second, &visited);
+            }
+        }
+
+        for (const std::string& path : mInputFiles) {
+            auto it = mFileStamps.find(path);
+            // Not read through onFileAccess, so it cannot be fingerprinted.
+            if (it == mFileStamps.end()) return;
+            inputs.insert(*it);
+        }
+        for (const std::string& path : mInputDirectories) {
+            auto it = mDirectoryListings.find(path);
+            if (it != mDirectoryListings.end()) {
+                lines.push_back("dir " + hashListing(it->second) + " " + path);
+            }
+        }
+    }
+
+    for (const auto& pair : inputs) {
+        // What was read cannot be fingerprinted if it changed since.
+        if (getFileStamp(pair.first) != pair.second) return;
+        lines.push_back("in " + Hash::hexString(Hash::sha256File(pair.first)) + " " + pair.first);
+    }
+    for (const std::string& path : outputFiles) {
+        lines.push_back("out " + Hash::hexString(Hash::sha256File(path)) + " " + path);
+    }
+
+    const std::string path = mCacheDir + key;
+    if (!makeParentHierarchy(path)) {
+        fprintf(stderr, "WARNING: could not make cache directory %s.\n", mCacheDir.c_str());
+        return;
+    }
+
+    // Renamed into place, other hidl-gen processes may read it meanwhile.
+    const std::string tmpPath = path + ".tmp." + std::to_string(getpid());
+    lines.push_back(kOutputsEnd);
+    if (!base::WriteStringToFile(StringHelper::JoinStrings(lines, "\n") + "\n", tmpPath) ||
+        rename(tmpPath.c_str(), path.c_str()) != 0) {
+        fprintf(stderr, "WARNING: could not write to cache %s: %d\n", path.c_str(), errno);
+        unlink(tmpPath.c_str());
+    }
+}
+
+void Coordinator::setJobs(size_t jobs) {
+    mJobs = std::max<size_t>(jobs, 1);
+}
+
+size_t Coordinator::getJobs() const {
+    return mJobs;
+}
+
+void Coordinator::onImportLookup(bool found) const {
+    mImportLookups++;
+    if (found) mImportLookupsFound++;
+}
+
+void Coordinator::onPendingImport(bool parsed) const {
+    if (parsed) {
+        mPendingImportsParsed++;
+    } else {
+        mPendingImports++;
+    }
+}
+
+void Coordinator::onFileSystemLookup(bool cached) const {
+    mFileSystemLookups++;
+    if (cached) mFileSystemLookupsCached++;
+}
+
+void Coordinator::printStatistics() const {
+    if (!mVerbose) return;
+
+    const size_t lookups = mImportLookups;
+    const size_t found = mImportLookupsFound;
+    fprintf(stderr, "VERBOSE: %zu lookups in imports, %zu (%.1f%%) found\n", lookups, found,
+            lookups == 0 ? 0.0 : 100.0 * found / lookups);
+
+    const size_t fileSystemLookups = mFileSystemLookups;
+    const size_t cached = mFileSystemLookupsCached;
+    fprintf(stderr, "VERBOSE: %zu directory lookups, %zu (%.1f%%) cached\n", fileSystemLookups,
+            cached, fileSystemLookups == 0 ? 0.0 : 100.0 * cached / fileSystemLookups);
+
+    const size_t pendingImports = mPendingImports;
+    const size_t parsed = mPendingImportsParsed;
+    fprintf(stderr, "VERBOSE: %zu interfaces imported with their package, %zu (%.1f%%) parsed\n",
+            pendingImports, parsed, pendingImports == 0 ? 0.0 : 100.0 * parsed / pendingImports);
+}
+
+bool Coordinator::parsesImportsLazily() const {
+    return mCacheDir.empty();
+}
+
+bool Coordinator::mayDefineType(const FQName& fqName, const std::string& localName) const {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto it = mFileIdentifiers.find(fqName);
+        if (it != mFileIdentifiers.end()) {
+            return it->second.identifiers.find(localName) != it->second.identifiers.end();
+        }
+    }
+
+    std::string packagePath;
+    status_t err =
+        getPackagePath(fqName, false /* relative */, false /* sanitized */, &packagePath);
+    // Parsing the file reports the error.
+    if (err != OK) return true;
+
+    FileIdentifiers file;
+    file.path = makeAbsolute(packagePath + fqName.name() + ".hal");
+
+    std::string contents;
+    if (!base::ReadFileToString(file.path, &contents)) return true;
+    onFileAccess(file.path, "r");
+
+    // Comments are not skipped, names in them only cause a file to be parsed
+    // needlessly.
+    auto isIdentifierChar = [](char c) {
+        return isalnum(static_cast<unsigned char>(c)) || c == '_';
+    };
+    for (size_t i = 0; i < contents.size();) {
+        if (!isIdentifierChar(contents[i])) {
+            i++;
+            continue;
+        }
+        size_t end = i;
+        while (end < contents.size() && isIdentifierChar(contents[end])) end++;
+        file.identifiers.emplace(contents, i, end - i);
+        i = end;
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    // Another thread may have read the file in the meantime.
+    auto it = mFileIdentifiers.emplace(fqName, std::move(file)).first;
+    return it->second.identifiers.find(localName) != it->second.identifiers.end();
+}
+
 const std::string& Coordinator::getOwner() const {
     return mOwner;
 }
@@ -113,19 +488,18 @@ Formatter Coordinator::getFormatter(const FQName& fqName, Location location,
 
     onFileAccess(filepath, "w");
 
-    if (!Coordinator::MakeParentHierarchy(filepath)) {
+    if (!makeParentHierarchy(filepath)) {
         fprintf(stderr, "ERROR: could not make directories for %s.\n", filepath.c_str());
         return Formatter::invalid();
     }
 
-    FILE* file = fopen(filepath.c_str(), "w");
-
-    if (file == nullptr) {
-        fprintf(stderr, "ERROR: could not open file %s: %d\n", filepath.c_str(), errno);
+    // Files whose contents do not change are left untouched so that their
+    // dependents are not rebuilt. Nothing is written until it is committed.
+    Formatter out(filepath);
+    if (!out.isValid()) {
         return Formatter::invalid();
     }
-
-    return Formatter(file);
+    return out;
 }
 
 status_t Coordinator::getFilepath(const FQName& fqName, Location location,
@@ -168,6 +542,11 @@ status_t Coordinator::getFilepath(const FQName& fqName, Location location,
 
 void Coordinator::onFileAccess(const std::string& path, const std::string& mode) const {
     if (mode == "r") {
+        FileStamp stamp = getFileStamp(path);
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        mFileStamps.emplace(path, stamp);
+        if (mRecordingInputs) mInputFiles.insert(path);
         // This is a global list. It's not cleared when a second fqname is processed for
         // two reasons:
         // 1). If there is a bug in hidl-gen, the dependencies on the first project from
@@ -196,6 +575,7 @@ status_t Coordinator::writeDepFile(const std::string& forFile) const {
         return UNKNOWN_ERROR;
     }
 
+    std::lock_guard<std::mutex> lock(mMutex);
     Formatter out(file, 2 /* spacesPerIndent */);
     out << StringHelper::LTrim(forFile, mOutputPath) << ": \\\n";
     out.indent([&] {
@@ -203,7 +583,7 @@ status_t Coordinator::writeDepFile(const std::string& forFile) const {
             out << StringHelper::LTrim(file, mRootPath) << " \\\n";
         }
     });
-    return OK;
+    return out.commit() ? OK : UNKNOWN_ERROR;
 }
 
 AST* Coordinator::parse(const FQName& fqName, std::set<AST*>* parsedASTs,
@@ -222,25 +602,106 @@ status_t Coordinator::parseOptional(const FQName& fqName, AST** ast, std::set<AS
                                     Enforce enforcement) const {
     CHECK(fqName.isFullyQualified());
 
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    // Wait for other threads to finish parsing fqName, unless they are
+    // (transitively) waiting for us.
+    while (mParsing.find(fqName) != mParsing.end()) {
+        if (isCircularImportLocked(fqName)) {
+            *ast = nullptr;
+            return UNKNOWN_ERROR;
+        }
+
+        mWaitingFor[std::this_thread::get_id()] = fqName;
+        mParsed.wait(lock);
+        mWaitingFor.erase(std::this_thread::get_id());
+    }
+
     auto it = mCache.find(fqName);
     if (it != mCache.end()) {
         *ast = (*it).second;
-
-        if (*ast != nullptr && parsedASTs != nullptr) {
-            parsedASTs->insert(*ast);
+        if (mFailedEnforcement.find(fqName) != mFailedEnforcement.end()) {
+            *ast = nullptr;
         }
+        // Parsed in an earlier run, restrictions are enforced as if it was
+        // parsed now.
+        const bool firstInRun = *ast != nullptr && markParsedInRunLocked(*ast);
+        lock.unlock();
+        Profiler::count(Profiler::Counter::PARSE_CACHE_HITS);
 
         if (*ast == nullptr) {
-            // circular import OR that AST has errors in it
+            // that AST has errors in it
             return UNKNOWN_ERROR;
         }
 
-        return OK;
+        if (parsedASTs != nullptr) {
+            parsedASTs->insert(*ast);
+        }
+
+        if (!firstInRun) {
+            return OK;
+        }
+        return enforceRestrictionsOnParsed(fqName, ast, enforcement);
     }
 
-    // Add this to the cache immediately, so we can discover circular imports.
-    mCache[fqName] = nullptr;
+    // Mark this as being parsed immediately, so we can discover circular imports.
+    mParsing[fqName] = std::this_thread::get_id();
+    lock.unlock();
 
+    status_t err = parseUncached(fqName, ast);
+
+    lock.lock();
+    mParsing.erase(fqName);
+    if (err != OK || *ast != nullptr) {
+        // put it into the cache now, so that enforceRestrictionsOnPackage can
+        // parse fqName.
+        mCache[fqName] = *ast;
+    }
+    if (*ast != nullptr) {
+        markParsedInRunLocked(*ast);
+    }
+    lock.unlock();
+    mParsed.notify_all();
+
+    if (err != OK || *ast == nullptr) {
+        // nullptr AST* == file doesn't exist.
+        return err;
+    }
+
+    if (parsedASTs != nullptr) {
+        parsedASTs->insert(*ast);
+    }
+
+    return enforceRestrictionsOnParsed(fqName, ast, enforcement);
+}
+
+// For each .hal file that hidl-gen parses, the whole package will be checked.
+status_t Coordinator::enforceRestrictionsOnParsed(const FQName& fqName, AST** ast,
+                                                  Enforce enforcement) const {
+    status_t err = enforceRestrictionsOnPackage(fqName, enforcement);
+    if (err != OK) {
+        // The AST is kept, another run may enforce it differently.
+        std::lock_guard<std::mutex> lock(mMutex);
+        mFailedEnforcement.insert(fqName);
+        *ast = nullptr;
+        return err;
+    }
+
+    return OK;
+}
+
+bool Coordinator::markParsedInRunLocked(const AST* ast) const {
+    if (!mParsedInRun.insert(ast).second) {
+        return false;
+    }
+    // A file is parsed after the files it imports, which are not enforced.
+    for (const AST* importedAST : ast->getImportedASTs()) {
+        markParsedInRunLocked(importedAST);
+    }
+    return true;
+}
+
+status_t Coordinator::parseUncached(const FQName& fqName, AST** ast) const {
     AST *typesAST = nullptr;
 
     if (fqName.name() != "types") {
@@ -260,7 +721,12 @@ status_t Coordinator::parseOptional(const FQName& fqName, AST** ast, std::set<AS
 
     const std::string path = makeAbsolute(packagePath + fqName.name() + ".hal");
 
-    *ast = new AST(this, &Hash::getHash(path));
+    const Hash* hash;
+    {
+        Profiler::Phase phase("hash", path);
+        hash = &Hash::getHash(path);
+    }
+    *ast = new AST(this, hash);
 
     if (typesAST != nullptr) {
         // If types.hal for this AST's package existed, make it's defined
@@ -271,16 +737,22 @@ status_t Coordinator::parseOptional(const FQName& fqName, AST** ast, std::set<AS
     std::unique_ptr<FILE, std::function<void(FILE*)>> file(fopen(path.c_str(), "rb"), fclose);
 
     if (file == nullptr) {
-        mCache.erase(fqName);  // nullptr in cache is used to find circular imports
         delete *ast;
         *ast = nullptr;
         return OK;  // File does not exist, nullptr AST* == file doesn't exist.
     }
 
     onFileAccess(path, "r");
+    Profiler::count(Profiler::Counter::FILES_PARSED);
 
     // parse file takes ownership of file
-    if (parseFile(*ast, std::move(file)) != OK || (*ast)->postParse() != OK) {
+    status_t parseErr;
+    {
+        // Lexing is not recorded separately, since the parser pulls tokens.
+        Profiler::Phase phase("parse", path);
+        parseErr = parseFile(*ast, std::move(file));
+    }
+    if (parseErr != OK || (*ast)->postParse() != OK) {
         delete *ast;
         *ast = nullptr;
         return UNKNOWN_ERROR;
@@ -336,24 +808,63 @@ status_t Coordinator::parseOptional(const FQName& fqName, AST** ast, std::set<AS
         return err;
     }
 
-    if (parsedASTs != nullptr) {
-        parsedASTs->insert(*ast);
+    return OK;
+}
+
+bool Coordinator::isCircularImportLocked(const FQName& fqName) const {
+    // Each waiting thread waits for exactly one AST, so following the owners
+    // either ends at a thread which is making progress or comes back to us.
+    for (auto parsing = mParsing.find(fqName); parsing != mParsing.end();) {
+        if (parsing->second == std::this_thread::get_id()) {
+            return true;
+        }
+
+        auto waiting = mWaitingFor.find(parsing->second);
+        if (waiting == mWaitingFor.end()) {
+            return false;
+        }
+        parsing = mParsing.find(waiting->second);
     }
+    return false;
+}
 
-    // put it into the cache now, so that enforceRestrictionsOnPackage can
-    // parse fqName.
-    mCache[fqName] = *ast;
+status_t Coordinator::parseInParallel(const std::vector<FQName>& fqNames,
+                                      Enforce enforcement) const {
+    std::unordered_set<const AST*> parsedInRun;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        parsedInRun = mParsedInRun;
+    }
 
-    // For each .hal file that hidl-gen parses, the whole package will be checked.
-    err = enforceRestrictionsOnPackage(fqName, enforcement);
-    if (err != OK) {
-        mCache[fqName] = nullptr;
-        delete *ast;
-        *ast = nullptr;
-        return err;
+    std::atomic<size_t> next(0);
+    std::atomic<bool> failed(false);
+
+    auto worker = [&] {
+        for (size_t i = next++; i < fqNames.size(); i = next++) {
+            if (parse(fqNames[i], nullptr /* parsedASTs */, enforcement) == nullptr) {
+                failed = true;
+            }
+        }
+    };
+
+    // This thread is one of the workers.
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < std::min(mJobs, fqNames.size()); i++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : threads) {
+        thread.join();
     }
 
-    return OK;
+    // Only the cache is filled, restrictions are enforced on the files once
+    // they are parsed for what they are used for.
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mParsedInRun = std::move(parsedInRun);
+    }
+
+    return failed ? UNKNOWN_ERROR : OK;
 }
 
 const Coordinator::PackageRoot* Coordinator::findPackageRoot(const FQName& fqName) const {
@@ -450,6 +961,19 @@ status_t Coordinator::getPackageInterfaceFiles(
     if (err != OK) return err;
 
     const std::string path = makeAbsolute(packagePath);
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mRecordingInputs) mInputDirectories.insert(path);
+        auto it = mDirectoryListings.find(path);
+        if (it != mDirectoryListings.end()) {
+            onFileSystemLookup(true /* cached */);
+            if (fileNames) *fileNames = it->second;
+            return OK;
+        }
+    }
+    onFileSystemLookup(false /* cached */);
+
     std::unique_ptr<DIR, decltype(&closedir)> dir(opendir(path.c_str()), closedir);
 
     if (dir == nullptr) {
@@ -458,49 +982,23 @@ status_t Coordinator::getPackageInterfaceFiles(
         return -errno;
     }
 
-    if (fileNames == nullptr) {
-        return OK;
-    }
-
-    struct dirent *ent;
-    while ((ent = readdir(dir.get())) != nullptr) {
-        // filesystems may not support d_type and return DT_UNKNOWN
-        if (ent->d_type == DT_UNKNOWN) {
-            struct stat sb;
-            const auto filename = packagePath + std::string(ent->d_name);
-            if (stat(filename.c_str(), &sb) == -1) {
-                fprintf(stderr, "ERROR: Could not stat %s\n", filename.c_str());
-                return -errno;
-            }
-            if ((sb.st_mode & S_IFMT) != S_IFREG) {
-                continue;
-            }
-        } else if (ent->d_type != DT_REG) {
-             continue;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mDirectoryStamps.find(path) == mDirectoryStamps.end()) {
+            mDirectoryStamps.emplace(path, getFileStamp(path));
         }
+    }
 
-        const auto suffix = ".hal";
-        const auto suffix_len = std::strlen(suffix);
-        const auto d_namelen = strlen(ent->d_name);
-
-        if (d_namelen < suffix_len
-                || strcmp(ent->d_name + d_namelen - suffix_len, suffix)) {
-            continue;
-        }
+    // The whole directory is listed even if only its existence is checked,
+    // so that the listing can be cached.
+    std::vector<std::string> listing;
+    err = listPackageDirectory(dir.get(), path, &listing);
+    if (err != OK) return err;
 
-        fileNames->push_back(std::string(ent->d_name, d_namelen - suffix_len));
-    }
+    if (fileNames) *fileNames = listing;
 
-    std::sort(fileNames->begin(), fileNames->end(),
-              [](const std::string& lhs, const std::string& rhs) -> bool {
-                  if (lhs == "types") {
-                      return true;
-                  }
-                  if (rhs == "types") {
-                      return false;
-                  }
-                  return lhs < rhs;
-              });
+    std::lock_guard<std::mutex> lock(mMutex);
+    mDirectoryListings.emplace(path, std::move(listing));
 
     return OK;
 }
@@ -617,6 +1115,122 @@ status_t Coordinator::addUnreferencedTypes(const std::vector<FQName>& packageInt
     return OK;
 }
 
+Coordinator::FileStamp Coordinator::getFileStamp(const std::string& path) {
+    struct stat st;
+    if (stat(path.c_str(), &st) < 0) {
+        return FileStamp(-1, -1, -1, -1);
+    }
+    return FileStamp(st.st_mtim.tv_sec, st.st_mtim.tv_nsec, st.st_size, st.st_ino);
+}
+
+size_t Coordinator::invalidateChangedFiles() {
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    // Directories are not stamped, e.x. output directories may have been
+    // removed since.
+    mDirectories.clear();
+
+    std::set<std::string> changedFiles;
+    for (auto it = mFileStamps.begin(); it != mFileStamps.end();) {
+        if (getFileStamp(it->first) == it->second) {
+            it++;
+            continue;
+        }
+
+        // stamped again once it is read again
+        changedFiles.insert(it->first);
+        it = mFileStamps.erase(it);
+    }
+
+    // Files were added to or removed from a package, or a hash file (or
+    // something else which is not a .hal file) changed. What this affects is
+    // not tracked, so everything is parsed again.
+    bool changedAll = std::any_of(changedFiles.begin(), changedFiles.end(),
+                                  [](const auto& path) {
+                                      return !StringHelper::EndsWith(path, ".hal");
+                                  });
+    for (const auto& pair : mDirectoryStamps) {
+        changedAll |= getFileStamp(pair.first) != pair.second;
+    }
+
+    if (changedFiles.empty() && !changedAll) {
+        return 0;
+    }
+
+    size_t invalidated = 0;
+    if (changedAll) {
+        for (const auto& path : changedFiles) {
+            Hash::invalidate(path);
+        }
+
+        invalidated = mCache.size();
+        mCache.clear();
+        mFileStamps.clear();
+        mDirectoryStamps.clear();
+        mDirectoryListings.clear();
+        mFileIdentifiers.clear();
+    } else {
+        for (const auto& path : changedFiles) {
+            Hash::invalidate(path);
+        }
+
+        // Files which were only scanned for identifiers, see mayDefineType.
+        std::unordered_set<FQName> changedPendingImports;
+        for (auto it = mFileIdentifiers.begin(); it != mFileIdentifiers.end();) {
+            if (changedFiles.find(it->second.path) != changedFiles.end()) {
+                changedPendingImports.insert(it->first);
+                it = mFileIdentifiers.erase(it);
+            } else {
+                it++;
+            }
+        }
+
+        // An AST is out of date if its file changed, or if anything it imports is out of date.
+        std::map<const AST*, bool> outOfDate;
+        std::function<bool(const AST*)> isOutOfDate = [&](const AST* ast) {
+            auto it = outOfDate.find(ast);
+            if (it != outOfDate.end()) return it->second;
+
+            bool result = changedFiles.find(ast->getFilename()) != changedFiles.end() ||
+                          std::any_of(ast->getPendingImports().begin(),
+                                      ast->getPendingImports().end(),
+                                      [&](const FQName& fqName) {
+                                          return changedPendingImports.find(fqName) !=
+                                                 changedPendingImports.end();
+                                      }) ||
+                          std::any_of(ast->getImportedASTs().begin(),
+                                      ast->getImportedASTs().end(), isOutOfDate);
+            outOfDate[ast] = result;
+            return result;
+        };
+
+        for (auto it = mCache.begin(); it != mCache.end();) {
+            // What ASTs with errors depend on is unknown.
+            if (it->second == nullptr || isOutOfDate(it->second)) {
+                invalidated++;
+                it = mCache.erase(it);
+            } else {
+                it++;
+            }
+        }
+    }
+
+    return invalidated;
+}
+
+void Coordinator::beginRun() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mParsedInRun.clear();
+    mFailedEnforcement.clear();
+    mPackagesEnforced.clear();
+    mUnfrozenFiles.clear();
+}
+
+bool Coordinator::isUnfrozen(const std::string& path) const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mUnfrozenFiles.find(path) != mUnfrozenFiles.end();
+}
+
 status_t Coordinator::enforceRestrictionsOnPackage(const FQName& fqName,
                                                    Enforce enforcement) const {
     CHECK(enforcement == Enforce::FULL || enforcement == Enforce::NO_HASH ||
@@ -635,29 +1249,128 @@ status_t Coordinator::enforceRestrictionsOnPackage(const FQName& fqName,
     }
 
     FQName package = fqName.getPackageAndVersion();
-    // look up cache.
-    if (mPackagesEnforced.find(package) != mPackagesEnforced.end()) {
-        return OK;
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        // A package which is being enforced by this thread (the rules
+        // themselves parse the package), or by a thread waiting for us, is
+        // checked by whoever started. Other threads wait for the result.
+        while (mPackagesEnforcing.find(package) != mPackagesEnforcing.end()) {
+            if (isCircularEnforcementLocked(package)) {
+                return OK;
+            }
+
+            mWaitingToEnforce[std::this_thread::get_id()] = package;
+            mParsed.wait(lock);
+            mWaitingToEnforce.erase(std::this_thread::get_id());
+        }
+
+        // look up cache.
+        if (mPackagesEnforced.find(package) != mPackagesEnforced.end()) {
+            return OK;
+        }
+        mPackagesEnforcing[package] = std::this_thread::get_id();
     }
 
+    Profiler::Phase phase("enforceRestrictionsOnPackage", package.string());
+
     // enforce all rules.
     status_t err;
 
-    err = enforceMinorVersionUprevs(package, enforcement);
-    if (err != OK) {
-        return err;
+    // Passing the check has no effect but its result, which is cached.
+    const std::string uprevKey = getMinorVersionUprevsKey(package, enforcement);
+    if (!uprevKey.empty() && isCached(uprevKey)) {
+        err = OK;
+    } else {
+        err = enforceMinorVersionUprevs(package, enforcement);
+        if (err == OK && !uprevKey.empty()) addToCache(uprevKey);
     }
 
-    if (enforcement != Enforce::NO_HASH) {
+    if (err == OK && enforcement != Enforce::NO_HASH) {
         err = enforceHashes(package);
-        if (err != OK) {
-            return err;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mPackagesEnforcing.erase(package);
+        // cache it so that it won't need to be enforced again.
+        if (err == OK) {
+            mPackagesEnforced.insert(package);
         }
     }
+    mParsed.notify_all();
 
-    // cache it so that it won't need to be enforced again.
-    mPackagesEnforced.insert(package);
-    return OK;
+    return err;
+}
+
+bool Coordinator::isCircularEnforcementLocked(const FQName& package) const {
+    // Like isCircularImportLocked, for threads waiting to enforce a package.
+    for (auto enforcing = mPackagesEnforcing.find(package);
+         enforcing != mPackagesEnforcing.end();) {
+        if (enforcing->second == std::this_thread::get_id()) {
+            return true;
+        }
+
+        auto waiting = mWaitingToEnforce.find(enforcing->second);
+        if (waiting == mWaitingToEnforce.end()) {
+            return false;
+        }
+        enforcing = mPackagesEnforcing.find(waiting->second);
+    }
+    return false;
+}
+
+std::string Coordinator::getMinorVersionUprevsKey(const FQName& currentPackage,
+                                                 Enforce enforcement) const {
+    static const char* const kUprevsCacheVersion = "hidl-gen-uprevs-2";
+
+    // @x.0 is not checked at all.
+    if (!hasCache() || !currentPackage.hasVersion() ||
+        currentPackage.getPackageMinorVersion() == 0) {
+        return "";
+    }
+
+    std::vector<std::string> parts = {kUprevsCacheVersion, currentPackage.string(),
+                                      std::to_string(static_cast<int>(enforcement))};
+
+    // The interfaces of this package are parsed anyway, their content hashes
+    // cover everything they import.
+    std::vector<FQName> packageInterfaces;
+    if (appendPackageInterfacesToVector(currentPackage, &packageInterfaces) != OK) return "";
+    for (const FQName& fqName : packageInterfaces) {
+        AST* ast = parse(fqName, nullptr /* parsedASTs */, enforcement);
+        if (ast == nullptr || ast->getContentHash().empty()) return "";
+        parts.push_back(fqName.name() + " " + ast->getContentHash());
+    }
+
+    // Earlier minor versions are what the check would parse, so only the
+    // files themselves are hashed. They are frozen in practice.
+    for (FQName prevPackage = currentPackage; prevPackage.getPackageMinorVersion() > 0;) {
+        prevPackage = prevPackage.downRev();
+
+        std::string prevPackagePath;
+        if (getPackagePath(prevPackage, false /* relative */, false /* sanitized */,
+                           &prevPackagePath) != OK) {
+            return "";
+        }
+        const std::string path = makeAbsolute(prevPackagePath);
+
+        parts.push_back(prevPackage.string());
+        if (!isDirectory(path)) continue;
+
+        std::vector<std::string> fileNames;
+        if (getPackageInterfaceFiles(prevPackage, &fileNames) != OK) return "";
+        std::vector<std::string> filePaths;
+        for (const std::string& fileName : fileNames) {
+            filePaths.push_back(path + fileName + ".hal");
+            onFileAccess(filePaths.back(), "r");
+        }
+        const std::vector<const Hash*> hashes = Hash::getHashes(filePaths, getJobs());
+        for (size_t i = 0; i < fileNames.size(); i++) {
+            parts.push_back(fileNames[i] + " " + hashes[i]->hexString());
+        }
+    }
+
+    return "uprevs-" + Hash::hexString(Hash::sha256(StringHelper::JoinStrings(parts, "\n")));
 }
 
 status_t Coordinator::enforceMinorVersionUprevs(const FQName& currentPackage,
@@ -682,7 +1395,7 @@ status_t Coordinator::enforceMinorVersionUprevs(const FQName& currentPackage,
                                       &prevPackagePath);
         if (err != OK) return err;
 
-        if (existdir(makeAbsolute(prevPackagePath).c_str())) {
+        if (isDirectory(makeAbsolute(prevPackagePath))) {
             hasPrevPackage = true;
             break;
         }
@@ -746,13 +1459,19 @@ status_t Coordinator::enforceMinorVersionUprevs(const FQName& currentPackage,
         }
 
         // Assume that currentFQName == android.hardware.foo@2.2::IFoo.
+        // Earlier versions are not enforced here, which would find their
+        // unfrozen files (see checkHash) unless this check is cached. They are
+        // enforced once they are used themselves.
+        auto parseLast = [&](const FQName& fqName) {
+            return parse(fqName, nullptr /* parsedASTs */, Enforce::NONE);
+        };
         FQName lastFQName(prevPackage.package(), prevPackage.version(),
                 currentFQName.name());
-        AST *lastAST = parse(lastFQName);
+        AST* lastAST = parseLast(lastFQName);
 
         for (; lastFQName.getPackageMinorVersion() > 0 &&
                (lastAST == nullptr || lastAST->getInterface() == nullptr)
-             ; lastFQName = lastFQName.downRev(), lastAST = parse(lastFQName)) {
+             ; lastFQName = lastFQName.downRev(), lastAST = parseLast(lastFQName)) {
             // nothing
         }
 
@@ -820,8 +1539,9 @@ Coordinator::HashStatus Coordinator::checkHash(const FQName& fqName) const {
 
     // hash not defined, interface not frozen
     if (frozen.size() == 0) {
-        // This ensures that it can be detected.
-        Hash::clearHash(ast->getFilename());
+        // This ensures that it can be detected, see AST::getOutputHash.
+        std::lock_guard<std::mutex> lock(mMutex);
+        mUnfrozenFiles.insert(ast->getFilename());
 
         return HashStatus::UNFROZEN;
     }
@@ -884,6 +1604,21 @@ status_t Coordinator::enforceHashes(const FQName& currentPackage) const {
         return err;
     }
 
+    // The files of the package are hashed at once, so that checkHash finds
+    // their hashes cached when it parses them.
+    std::string packagePath;
+    err = getPackagePath(currentPackage, false /* relative */, false /* sanitized */,
+                         &packagePath);
+    if (err != OK) return err;
+    {
+        Profiler::Phase phase("hash", currentPackage.string());
+        std::vector<std::string> paths;
+        for (const FQName& currentFQName : packageInterfaces) {
+            paths.push_back(makeAbsolute(packagePath + currentFQName.name() + ".hal"));
+        }
+        Hash::getHashes(paths, getJobs());
+    }
+
     for (const FQName& currentFQName : packageInterfaces) {
         HashStatus status = checkHash(currentFQName);
         switch (status) {
@@ -915,29 +1650,53 @@ status_t Coordinator::enforceHashes(const FQName& currentPackage) const {
     return err;
 }
 
-bool Coordinator::MakeParentHierarchy(const std::string &path) {
+bool Coordinator::isDirectory(const std::string& path) const {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto it = mDirectories.find(path);
+        if (it != mDirectories.end()) {
+            onFileSystemLookup(true /* cached */);
+            return it->second;
+        }
+    }
+    onFileSystemLookup(false /* cached */);
+
+    struct stat st;
+    bool isDirectory = stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mDirectories[path] = isDirectory;
+    return isDirectory;
+}
+
+bool Coordinator::makeParentHierarchy(const std::string &path) const {
     static const mode_t kMode = 0755;
 
-    size_t start = 1;  // Ignore leading '/'
+    // Directories are made from the deepest one which is known to exist, in
+    // most cases all of them already are.
+    size_t start = path.rfind('/');
+    if (start == std::string::npos || start == 0) return true;
+    while (start != 0 && start != std::string::npos && !isDirectory(path.substr(0, start))) {
+        start = path.rfind('/', start - 1);
+    }
+    if (start == std::string::npos) start = 0;
+
     size_t slashPos;
-    while ((slashPos = path.find('/', start)) != std::string::npos) {
+    while ((slashPos = path.find('/', start + 1)) != std::string::npos) {
         std::string partial = path.substr(0, slashPos);
 
-        struct stat st;
-        if (stat(partial.c_str(), &st) < 0) {
-            if (errno != ENOENT) {
+        if (mkdir(partial.c_str(), kMode) < 0) {
+            // Another thread or process may have made it in the meantime.
+            struct stat st;
+            if (errno != EEXIST || stat(partial.c_str(), &st) < 0 || !S_ISDIR(st.st_mode)) {
                 return false;
             }
-
-            int res = mkdir(partial.c_str(), kMode);
-            if (res < 0) {
-                return false;
-            }
-        } else if (!S_ISDIR(st.st_mode)) {
-            return false;
         }
 
-        start = slashPos + 1;
+        std::lock_guard<std::mutex> lock(mMutex);
+        mDirectories[partial] = true;
+
+        start = slashPos;
     }
 
     return true;
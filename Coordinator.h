@@ -22,9 +22,16 @@
 #include <hidl-util/FQName.h>
 #include <hidl-util/Formatter.h>
 #include <utils/Errors.h>
+#include <atomic>
+#include <condition_variable>
 #include <map>
+#include <mutex>
 #include <set>
 #include <string>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 namespace android {
@@ -43,6 +50,66 @@ struct Coordinator {
     bool isVerbose() const;
 
     void setDepFile(const std::string& depFile);
+    bool hasDepFile() const;
+
+    // Directory to remember results in across invocations. Results are
+    // keyed by (hashes of) everything they depend on, so the directory never
+    // needs to be invalidated. No results are remembered if this is not set.
+    void setCacheDir(const std::string& cacheDir);
+
+    // Whether results are remembered, i.e. there is a cache directory and
+    // getToolHash is known. Keys must then include getToolHash.
+    bool hasCache() const;
+
+    // Whether key was added to the cache directory by any invocation.
+    bool isCached(const std::string& key) const;
+    void addToCache(const std::string& key) const;
+
+    // Hash of the code of hidl-gen, so that results of another hidl-gen are
+    // not reused. Empty if the code cannot be found.
+    static const std::string& getToolHash();
+
+    // Generated files are fingerprinted in the cache directory, along with
+    // every file and package directory read to generate them. The key is
+    // derived from description (e.x. language and FQName) and the options of
+    // this Coordinator, it is empty if results are not cached.
+    std::string getOutputsKey(const std::string& description) const;
+    // Whether the outputs recorded for key exist, and neither they nor
+    // anything they were generated from changed since. The inputs are
+    // reported as read, see onFileAccess.
+    bool areOutputsUpToDate(const std::string& key) const;
+    // Starts collecting what is read to generate the outputs of a key.
+    void startRecordingInputs() const;
+    // Records the outputs of key, generated for fqName since
+    // startRecordingInputs. The inputs are what was read since, along with
+    // the files of the ASTs of the package of fqName and of everything they
+    // import, which may have been parsed before.
+    void recordOutputs(const std::string& key, const FQName& fqName,
+                       const std::vector<std::string>& outputFiles) const;
+
+    // Number of threads hidl-gen may use, at least 1.
+    void setJobs(size_t jobs);
+    size_t getJobs() const;
+
+    // Counts lookups of type names among the imports of an AST, and whether
+    // any imported AST defines such a name.
+    void onImportLookup(bool found) const;
+    // Counts interfaces imported with their whole package, and whether they
+    // were parsed because a lookup needed them.
+    void onPendingImport(bool parsed) const;
+
+    // Whether interfaces imported with their whole package are only parsed
+    // once a lookup needs them, see AST::addImport. They are not if results
+    // are cached, since cache keys cover everything a file imports.
+    bool parsesImportsLazily() const;
+
+    // Whether the file of fqName may define a type with the given local name,
+    // i.e. whether the name appears in it as an identifier. Does not parse the
+    // file, the identifiers in it are remembered until invalidateChangedFiles.
+    bool mayDefineType(const FQName& fqName, const std::string& localName) const;
+
+    // Prints counters collected so far if verbose.
+    void printStatistics() const;
 
     const std::string& getOwner() const;
     void setOwner(const std::string& owner);
@@ -95,6 +162,14 @@ struct Coordinator {
     status_t parseOptional(const FQName& fqName, AST** ast, std::set<AST*>* parsedASTs = nullptr,
                            Enforce enforcement = Enforce::FULL) const;
 
+    // Parses all of fqNames on up to getJobs() threads. Files which are
+    // imported by more than one of them are only parsed once. Must not be
+    // called while parsing. This only fills the cache: restrictions are
+    // enforced once the files are parsed again, as if they were parsed then.
+    // Returns OK if every one of fqNames exists and could be parsed.
+    status_t parseInParallel(const std::vector<FQName>& fqNames,
+                             Enforce enforcement = Enforce::FULL) const;
+
     // Given package-root paths of ["hardware/interfaces",
     // "vendor/<something>/interfaces"], package roots of
     // ["android.hardware", "vendor.<something>.hardware"], and a
@@ -125,6 +200,19 @@ struct Coordinator {
                                   std::set<FQName>* unreferencedDefinitions,
                                   std::set<FQName>* unreferencedImports) const;
 
+    // Forgets parsed files (and everything derived from them) which changed on
+    // disk since they were read, or which import such a file. Returns the
+    // number of ASTs forgotten. Must not be called while parsing.
+    size_t invalidateChangedFiles();
+
+    // Starts another batch line. Which files were parsed and which packages
+    // were enforced, and what that found, is forgotten, so that the line
+    // gives the same output as a hidl-gen process of its own.
+    void beginRun();
+
+    // Whether checkHash found the file at path unfrozen in this run.
+    bool isUnfrozen(const std::string& path) const;
+
     // Enforce a set of restrictions on a set of packages. These include:
     //    - minor version upgrades
     // "packages" contains names like "android.hardware.nfc@1.1".
@@ -133,7 +221,40 @@ struct Coordinator {
                                           Enforce enforcement = Enforce::FULL) const;
 
 private:
-    static bool MakeParentHierarchy(const std::string &path);
+    // Makes all directories leading up to path. Directories which are known
+    // to exist are not checked again.
+    bool makeParentHierarchy(const std::string &path) const;
+
+    // Whether path is a directory, cached until invalidateChangedFiles.
+    bool isDirectory(const std::string& path) const;
+
+    void onFileSystemLookup(bool cached) const;
+
+    // parseOptional without the cache and without enforcing restrictions.
+    status_t parseUncached(const FQName& fqName, AST** ast) const;
+
+    // Modification time (s, ns), size and inode, to detect changes to files.
+    using FileStamp = std::tuple<int64_t, int64_t, int64_t, int64_t>;
+    static FileStamp getFileStamp(const std::string& path);
+
+    // Whether waiting for another thread to finish parsing fqName would never
+    // return, because that thread (transitively) waits for us. mMutex must be held.
+    bool isCircularImportLocked(const FQName& fqName) const;
+    // Whether the thread enforcing package (transitively) waits for us.
+    // mMutex must be held.
+    bool isCircularEnforcementLocked(const FQName& package) const;
+
+    // Enforces restrictions on the package of ast, which was just parsed for
+    // the first time in this run. On failure ast is set to nullptr, and
+    // fqName fails to parse for the rest of the run.
+    status_t enforceRestrictionsOnParsed(const FQName& fqName, AST** ast,
+                                         Enforce enforcement) const;
+    // Records that ast and everything it imports were parsed in this run.
+    // Returns false if ast already was. mMutex must be held.
+    bool markParsedInRunLocked(const AST* ast) const;
+    // Adds the files and package directories of ast and of everything it
+    // imports to mInputFiles and mInputDirectories. mMutex must be held.
+    void addInputsLocked(const AST* ast, std::set<const AST*>* visited) const;
 
     enum class HashStatus {
         ERROR,
@@ -168,25 +289,82 @@ private:
     std::string mRootPath;    // root of android source tree (to locate package roots)
     std::string mOutputPath;  // root of output directory
     std::string mDepFile;     // location to write depfile
+    std::string mCacheDir;    // location of results from previous invocations
 
     // hidl-gen options
     bool mVerbose = false;
     std::string mOwner;
+    size_t mJobs = 1;
+
+    mutable std::atomic<size_t> mImportLookups{0};
+    mutable std::atomic<size_t> mImportLookupsFound{0};
+    mutable std::atomic<size_t> mFileSystemLookups{0};
+    mutable std::atomic<size_t> mFileSystemLookupsCached{0};
+    mutable std::atomic<size_t> mPendingImports{0};
+    mutable std::atomic<size_t> mPendingImportsParsed{0};
+
+    // guards everything below, parse() may be called from multiple threads.
+    mutable std::mutex mMutex;
 
     // cache to parse().
-    mutable std::map<FQName, AST *> mCache;
+    mutable std::unordered_map<FQName, AST*> mCache;
+
+    // ASTs which are being parsed, and the thread parsing each of them.
+    mutable std::unordered_map<FQName, std::thread::id> mParsing;
+    // The AST each thread blocked in parse() is waiting for.
+    mutable std::map<std::thread::id, FQName> mWaitingFor;
+    // notified whenever an AST is removed from mParsing, or a package from
+    // mPackagesEnforcing.
+    mutable std::condition_variable mParsed;
+
+    // Restrictions are enforced when a file is parsed for the first time in
+    // a run, see beginRun. A file may have been parsed in an earlier one.
+    mutable std::unordered_set<const AST*> mParsedInRun;
+    // Files whose packages failed to be enforced in this run.
+    mutable std::unordered_set<FQName> mFailedEnforcement;
 
     // cache to enforceRestrictionsOnPackage().
-    mutable std::set<FQName> mPackagesEnforced;
+    mutable std::unordered_set<FQName> mPackagesEnforced;
+    // Packages which are being enforced, and the thread enforcing each.
+    mutable std::unordered_map<FQName, std::thread::id> mPackagesEnforcing;
+    // The package each thread blocked in enforceRestrictionsOnPackage waits for.
+    mutable std::map<std::thread::id, FQName> mWaitingToEnforce;
+    // see isUnfrozen
+    mutable std::unordered_set<std::string> mUnfrozenFiles;
 
     mutable std::set<std::string> mReadFiles;
 
+    // see startRecordingInputs
+    mutable bool mRecordingInputs = false;
+    mutable std::set<std::string> mInputFiles;
+    mutable std::set<std::string> mInputDirectories;
+
+    // see invalidateChangedFiles
+    mutable std::map<std::string, FileStamp> mFileStamps;
+    mutable std::map<std::string, FileStamp> mDirectoryStamps;
+
+    // .hal files in each package directory, see getPackageInterfaceFiles.
+    // Changes are detected through mDirectoryStamps.
+    mutable std::unordered_map<std::string, std::vector<std::string>> mDirectoryListings;
+    // see isDirectory
+    mutable std::unordered_map<std::string, bool> mDirectories;
+
+    // see mayDefineType
+    struct FileIdentifiers {
+        std::string path;
+        std::unordered_set<std::string> identifiers;
+    };
+    mutable std::unordered_map<FQName, FileIdentifiers> mFileIdentifiers;
+
     // Returns the given path if it is absolute, otherwise it returns
     // the path relative to mRootPath
     std::string makeAbsolute(const std::string& string) const;
 
     // Rules of enforceRestrictionsOnPackage are listed below.
     status_t enforceMinorVersionUprevs(const FQName& fqName, Enforce enforcement) const;
+    // Key under which enforceMinorVersionUprevs passing is recorded in the
+    // cache directory, empty if the result cannot be cached.
+    std::string getMinorVersionUprevsKey(const FQName& fqName, Enforce enforcement) const;
     status_t enforceHashes(const FQName &fqName) const;
 
     DISALLOW_COPY_AND_ASSIGN(Coordinator);
@@ -18,8 +18,11 @@
 
 #include <hidl-util/Formatter.h>
 #include <inttypes.h>
+#include <algorithm>
+#include <string.h>
 #include <iostream>
 #include <unordered_map>
+#include <unordered_set>
 
 #include "Annotation.h"
 #include "Location.h"
@@ -83,16 +86,16 @@ status_t EnumType::resolveInheritance() {
     return Scope::resolveInheritance();
 }
 
-std::vector<const Reference<Type>*> EnumType::getReferences() const {
-    return {&mStorageType};
+status_t EnumType::visitReferences(Visitor<const Reference<Type>*> func) const {
+    return func(&mStorageType);
 }
 
-std::vector<const ConstantExpression*> EnumType::getConstantExpressions() const {
-    std::vector<const ConstantExpression*> ret;
+status_t EnumType::visitConstantExpressions(Visitor<const ConstantExpression*> func) const {
     for (const auto* value : mValues) {
-        ret.push_back(value->constExpr());
+        status_t err = func(value->constExpr());
+        if (err != OK) return err;
     }
-    return ret;
+    return OK;
 }
 
 status_t EnumType::validate() const {
@@ -390,7 +393,10 @@ void EnumType::emitPackageTypeDeclarations(Formatter& out) const {
     out << "template<typename>\n"
         << "static inline std::string toString(" << resolveToScalarType()->getCppArgumentType()
         << " o);\n";
-    out << "static inline std::string toString(" << getCppArgumentType() << " o);\n\n";
+    out << "static inline std::string toString(" << getCppArgumentType() << " o);\n";
+    out << "// Sets *o to the value named name, returns false if there is none.\n";
+    out << "static inline bool fromString(const std::string& name, " << getCppStackType()
+        << "* o);\n\n";
 
     emitEnumBitwiseOperator(out, true  /* lhsIsEnum */, true  /* rhsIsEnum */, "|");
     emitEnumBitwiseOperator(out, false /* lhsIsEnum */, true  /* rhsIsEnum */, "|");
@@ -405,10 +411,90 @@ void EnumType::emitPackageTypeDeclarations(Formatter& out) const {
     out.endl();
 }
 
+// Hash of names in generated fromString functions, FNV-1a with the given
+// offset basis. Must match the code emitted by emitFromString.
+static uint32_t hashEnumValueName(uint32_t seed, const std::string& name) {
+    uint32_t hash = seed;
+    for (char c : name) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static constexpr uint32_t kFnvOffsetBasis = 2166136261u;
+
+// Builds a two-level perfect hash of names ("hash and displace"): the hash of
+// a name with kFnvOffsetBasis picks one of names.size() buckets, and its hash
+// with that bucket's seed picks one of names.size() slots. On success, fills
+// in the seed of each bucket and the slot of each name. Fails if some bucket
+// has no suitable seed within a bounded number of tries.
+static bool findPerfectHashSeeds(const std::vector<std::string>& names,
+                                 std::vector<uint32_t>* seeds, std::vector<size_t>* slots) {
+    const size_t n = names.size();
+    const size_t maxTries = 16 * n + 256;
+
+    std::vector<std::vector<size_t>> buckets(n);
+    for (size_t i = 0; i < n; i++) {
+        buckets[hashEnumValueName(kFnvOffsetBasis, names[i]) % n].push_back(i);
+    }
+
+    // Larger buckets are the hardest to place, so they go first.
+    std::vector<size_t> order(n);
+    for (size_t i = 0; i < n; i++) order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](size_t lhs, size_t rhs) {
+        return buckets[lhs].size() > buckets[rhs].size();
+    });
+
+    seeds->assign(n, 0);
+    slots->assign(n, 0);
+    std::vector<bool> used(n);
+    for (size_t bucket : order) {
+        if (buckets[bucket].empty()) break;
+
+        bool placed = false;
+        for (size_t tries = 1; tries <= maxTries && !placed; tries++) {
+            const uint32_t seed = kFnvOffsetBasis + static_cast<uint32_t>(tries) * 0x9e3779b9u;
+            std::vector<size_t> bucketSlots;
+            placed = true;
+            for (size_t i : buckets[bucket]) {
+                const size_t slot = hashEnumValueName(seed, names[i]) % n;
+                if (used[slot] || std::find(bucketSlots.begin(), bucketSlots.end(), slot) !=
+                                          bucketSlots.end()) {
+                    placed = false;
+                    break;
+                }
+                bucketSlots.push_back(slot);
+            }
+            if (!placed) continue;
+
+            (*seeds)[bucket] = seed;
+            for (size_t j = 0; j < bucketSlots.size(); j++) {
+                used[bucketSlots[j]] = true;
+                (*slots)[buckets[bucket][j]] = bucketSlots[j];
+            }
+        }
+        if (!placed) return false;
+    }
+    return true;
+}
+
 void EnumType::emitPackageTypeHeaderDefinitions(Formatter& out) const {
     const ScalarType *scalarType = mStorageType->resolveToScalarType();
     CHECK(scalarType != nullptr);
 
+    std::vector<const EnumValue*> values;
+    forEachValueFromRoot([&](EnumValue* value) { values.push_back(value); });
+
+    // Names are appended to a single buffer, large enough for all of them,
+    // the remaining bits and the value in hex.
+    size_t align, size;
+    scalarType->getAlignmentAndSize(&align, &size);
+    size_t bitfieldStringSize = 2 * (strlen(" | -0x") + 2 * size) + strlen(" ()");
+    for (const EnumValue* value : values) {
+        bitfieldStringSize += strlen(" | ") + value->name().size();
+    }
+
     out << "template<>\n"
         << "inline std::string toString<" << getCppStackType() << ">("
         << scalarType->getCppArgumentType() << " o) ";
@@ -416,19 +502,29 @@ void EnumType::emitPackageTypeHeaderDefinitions(Formatter& out) const {
         // include toHexString for scalar types
         out << "using ::android::hardware::details::toHexString;\n"
             << "std::string os;\n"
+            << "os.reserve(" << bitfieldStringSize << ");\n"
             << getBitfieldCppType(StorageMode_Stack) << " flipped = 0;\n"
             << "bool first = true;\n";
-        forEachValueFromRoot([&](EnumValue* value) {
-            std::string valueName = fullName() + "::" + value->name();
-            out.sIf("(o & " + valueName + ")" +
-                    " == static_cast<" + scalarType->getCppStackType() +
-                    ">(" + valueName + ")", [&] {
-                out << "os += (first ? \"\" : \" | \");\n"
-                    << "os += \"" << value->name() << "\";\n"
-                    << "first = false;\n"
-                    << "flipped |= " << valueName << ";\n";
+        if (!values.empty()) {
+            out << "struct Value { " << scalarType->getCppStackType()
+                << " value; const char* name; };\n";
+            out << "static constexpr Value kValues[] = ";
+            out.block([&] {
+                for (const EnumValue* value : values) {
+                    out << "{static_cast<" << scalarType->getCppStackType() << ">(" << fullName()
+                        << "::" << value->name() << "), \"" << value->name() << "\"},\n";
+                }
+            }) << ";\n";
+            out << "for (const Value& v : kValues) ";
+            out.block([&] {
+                out.sIf("(o & v.value) == v.value", [&] {
+                    out << "os += (first ? \"\" : \" | \");\n"
+                        << "os += v.name;\n"
+                        << "first = false;\n"
+                        << "flipped |= v.value;\n";
+                }).endl();
             }).endl();
-        });
+        }
         // put remaining bits
         out.sIf("o != flipped", [&] {
             out << "os += (first ? \"\" : \" | \");\n";
@@ -445,16 +541,118 @@ void EnumType::emitPackageTypeHeaderDefinitions(Formatter& out) const {
 
     out.block([&] {
         out << "using ::android::hardware::details::toHexString;\n";
-        forEachValueFromRoot([&](EnumValue* value) {
-            out.sIf("o == " + fullName() + "::" + value->name(), [&] {
-                out << "return \"" << value->name() << "\";\n";
+        if (!values.empty()) {
+            // Values may have several names, the first one is used.
+            std::unordered_set<std::string> seen;
+            out << "switch (o) ";
+            out.block([&] {
+                for (const EnumValue* value : values) {
+                    if (!seen.insert(value->rawValue(scalarType->getKind())).second) continue;
+                    out << "case " << fullName() << "::" << value->name() << ": return \""
+                        << value->name() << "\";\n";
+                }
             }).endl();
-        });
+        }
         out << "std::string os;\n";
         scalarType->emitHexDump(out, "os",
             "static_cast<" + scalarType->getCppStackType() + ">(o)");
         out << "return os;\n";
     }).endl().endl();
+
+    emitFromString(out, values);
+}
+
+void EnumType::emitFromString(Formatter& out, const std::vector<const EnumValue*>& values) const {
+    out << "static inline bool fromString(const std::string& name, " << getCppStackType()
+        << "* o) ";
+    out.block([&] {
+        if (values.empty()) {
+            out << "(void)name;\n"
+                << "(void)o;\n"
+                << "return false;\n";
+            return;
+        }
+
+        std::vector<std::string> names;
+        for (const EnumValue* value : values) names.push_back(value->name());
+        std::vector<uint32_t> seeds;
+        std::vector<size_t> valueSlots;
+        if (!findPerfectHashSeeds(names, &seeds, &valueSlots)) {
+            emitFromStringBinarySearch(out, values);
+            return;
+        }
+
+        std::vector<const EnumValue*> slots(values.size());
+        for (size_t i = 0; i < values.size(); i++) slots[valueSlots[i]] = values[i];
+
+        // Names are looked up in a two-level perfect hash table computed by
+        // hidl-gen: the first hash picks a seed, the second one a slot.
+        out << "struct Slot { const char* name; " << getCppStackType() << " value; };\n";
+        out << "static constexpr uint32_t kSeeds[] = ";
+        out.block([&] {
+            for (uint32_t seed : seeds) out << seed << "u,\n";
+        }) << ";\n";
+        out << "static constexpr Slot kSlots[] = ";
+        out.block([&] {
+            for (const EnumValue* value : slots) {
+                out << "{\"" << value->name() << "\", " << fullName() << "::" << value->name()
+                    << "},\n";
+            }
+        }) << ";\n";
+        out << "uint32_t hash = " << kFnvOffsetBasis << "u;\n";
+        out << "for (char c : name) ";
+        out.block([&] {
+            out << "hash ^= static_cast<uint8_t>(c);\n"
+                << "hash *= 16777619u;\n";
+        }).endl();
+        out << "hash = kSeeds[hash % " << values.size() << "u];\n";
+        out << "for (char c : name) ";
+        out.block([&] {
+            out << "hash ^= static_cast<uint8_t>(c);\n"
+                << "hash *= 16777619u;\n";
+        }).endl();
+        out << "const Slot& slot = kSlots[hash % " << values.size() << "u];\n";
+        out.sIf("name != slot.name", [&] {
+            out << "return false;\n";
+        }).endl();
+        out << "*o = slot.value;\n"
+            << "return true;\n";
+    }).endl().endl();
+}
+
+void EnumType::emitFromStringBinarySearch(Formatter& out,
+                                          const std::vector<const EnumValue*>& values) const {
+    std::vector<const EnumValue*> sorted = values;
+    std::stable_sort(sorted.begin(), sorted.end(), [](const EnumValue* lhs, const EnumValue* rhs) {
+        return lhs->name() < rhs->name();
+    });
+
+    // Fallback when no perfect hash was found: names are sorted by hidl-gen.
+    out << "struct Entry { const char* name; " << getCppStackType() << " value; };\n";
+    out << "static constexpr Entry kEntries[] = ";
+    out.block([&] {
+        for (const EnumValue* value : sorted) {
+            out << "{\"" << value->name() << "\", " << fullName() << "::" << value->name()
+                << "},\n";
+        }
+    }) << ";\n";
+    out << "size_t lo = 0;\n"
+        << "size_t hi = " << sorted.size() << ";\n";
+    out << "while (lo < hi) ";
+    out.block([&] {
+        out << "const size_t mid = lo + (hi - lo) / 2;\n"
+            << "const int cmp = name.compare(kEntries[mid].name);\n";
+        out.sIf("cmp == 0", [&] {
+            out << "*o = kEntries[mid].value;\n"
+                << "return true;\n";
+        }).endl();
+        out.sIf("cmp < 0", [&] {
+            out << "hi = mid;\n";
+        }).sElse([&] {
+            out << "lo = mid + 1;\n";
+        }).endl();
+    }).endl();
+    out << "return false;\n";
 }
 
 void EnumType::emitJavaTypeDeclarations(Formatter& out, bool atTopLevel) const {
@@ -68,8 +68,8 @@ struct EnumType : public Scope {
     // Return the type that corresponds to bitfield<T>.
     const BitFieldType* getBitfieldType() const;
 
-    std::vector<const Reference<Type>*> getReferences() const override;
-    std::vector<const ConstantExpression*> getConstantExpressions() const override;
+    status_t visitReferences(Visitor<const Reference<Type>*> func) const override;
+    status_t visitConstantExpressions(Visitor<const ConstantExpression*> func) const override;
 
     status_t resolveInheritance() override;
     status_t validate() const override;
@@ -124,6 +124,10 @@ struct EnumType : public Scope {
     void emitIteratorDeclaration(Formatter& out) const;
     void emitIteratorDefinitions(Formatter& out) const;
 
+    void emitFromString(Formatter& out, const std::vector<const EnumValue*>& values) const;
+    void emitFromStringBinarySearch(Formatter& out,
+                                    const std::vector<const EnumValue*>& values) const;
+
     void emitEnumBitwiseOperator(
             Formatter &out,
             bool lhsIsEnum,
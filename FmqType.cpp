@@ -151,6 +151,15 @@ void FmqType::getAlignmentAndSize(
     *size = assertion.size();
 }
 
+size_t FmqType::getParcelDataSizeHint() const {
+    return kParcelBufferObjectSize + getEmbeddedParcelDataSizeHint();
+}
+
+// The grantors and the handle.
+size_t FmqType::getEmbeddedParcelDataSizeHint() const {
+    return kParcelBufferObjectSize + kParcelBufferObjectSize + kParcelFdArrayObjectSize;
+}
+
 bool FmqType::needsEmbeddedReadWrite() const {
     return true;
 }
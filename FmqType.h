@@ -58,6 +58,9 @@ struct FmqType : public TemplatedType {
 
     void getAlignmentAndSize(size_t *align, size_t *size) const override;
 
+    size_t getParcelDataSizeHint() const override;
+    size_t getEmbeddedParcelDataSizeHint() const override;
+
     bool needsEmbeddedReadWrite() const override;
     bool resultNeedsDeref() const override;
     bool isCompatibleElementType(const Type* elementType) const override;
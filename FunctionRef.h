@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FUNCTION_REF_H_
+
+#define FUNCTION_REF_H_
+
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace android {
+
+template <typename Fn>
+struct FunctionRef;
+
+/**
+ * Non-owning reference to a callable. Unlike std::function, it never
+ * allocates, so it is meant for callback parameters which are called on hot
+ * paths. It must not outlive the callable it refers to.
+ */
+template <typename Ret, typename... Args>
+struct FunctionRef<Ret(Args...)> {
+    template <typename Callable,
+              typename = std::enable_if_t<
+                  !std::is_same_v<std::decay_t<Callable>, FunctionRef> &&
+                  std::is_invocable_r_v<Ret, Callable&, Args...>>>
+    FunctionRef(Callable&& callable)
+        : mCallable(const_cast<void*>(static_cast<const void*>(std::addressof(callable)))),
+          mInvoke(&invoke<std::remove_reference_t<Callable>>) {}
+
+    Ret operator()(Args... args) const {
+        return mInvoke(mCallable, std::forward<Args>(args)...);
+    }
+
+   private:
+    template <typename Callable>
+    static Ret invoke(void* callable, Args... args) {
+        return (*static_cast<Callable*>(callable))(std::forward<Args>(args)...);
+    }
+
+    void* mCallable;
+    Ret (*mInvoke)(void*, Args...);
+};
+
+}  // namespace android
+
+#endif  // FUNCTION_REF_H_
@@ -184,6 +184,15 @@ void HandleType::getAlignmentAndSize(size_t *align, size_t *size) const {
     *size = assertion.size();
 }
 
+// The native_handle and its file descriptors.
+size_t HandleType::getParcelDataSizeHint() const {
+    return kParcelBufferObjectSize + kParcelFdArrayObjectSize;
+}
+
+size_t HandleType::getEmbeddedParcelDataSizeHint() const {
+    return kParcelBufferObjectSize + kParcelFdArrayObjectSize;
+}
+
 void HandleType::emitVtsTypeDeclarations(Formatter& out) const {
     out << "type: " << getVtsType() << "\n";
 }
@@ -81,6 +81,9 @@ struct HandleType : public Type {
 
     void getAlignmentAndSize(size_t *align, size_t *size) const override;
 
+    size_t getParcelDataSizeHint() const override;
+    size_t getEmbeddedParcelDataSizeHint() const override;
+
     void emitVtsTypeDeclarations(Formatter& out) const override;
 };
 
@@ -16,6 +16,7 @@
 
 #include "Interface.h"
 
+#include "AST.h"
 #include "Annotation.h"
 #include "ArrayType.h"
 #include "ConstantExpression.h"
@@ -71,18 +72,23 @@ enum {
 const std::unique_ptr<ConstantExpression> Interface::FLAG_ONE_WAY =
     std::make_unique<LiteralConstantExpression>(ScalarType::KIND_UINT32, 0x01, "oneway");
 
+// The methods of IBase, which every interface has.
+static std::map<std::string, Method *> gAllReservedMethods;
+
 Interface::Interface(const char* localName, const FQName& fullName, const Location& location,
-                     Scope* parent, const Reference<Type>& superType, const Hash* fileHash)
-    : Scope(localName, fullName, location, parent), mSuperType(superType), mFileHash(fileHash) {}
+                     Scope* parent, const Reference<Type>& superType, const AST* ast)
+    : Scope(localName, fullName, location, parent), mSuperType(superType), mAST(ast) {
+    // IBase is parsed again once the Coordinator invalidates it, and the
+    // methods of the previous parse are deleted with its AST.
+    if (isIBase()) {
+        gAllReservedMethods.clear();
+    }
+}
 
 std::string Interface::typeName() const {
     return "interface " + localName();
 }
 
-const Hash* Interface::getFileHash() const {
-    return mFileHash;
-}
-
 bool Interface::fillPingMethod(Method *method) const {
     if (method->name() != "ping") {
         return false;
@@ -297,15 +303,16 @@ void Interface::emitDigestChain(
     out.join(chain.begin(), chain.end(), ",\n", [&](const auto& iface) {
         out << prefix;
         out << "{";
+        const std::vector<uint8_t>& hash = iface->mAST->getOutputHash();
         out.join(
-            iface->getFileHash()->raw().begin(), iface->getFileHash()->raw().end(), ",",
+            hash.begin(), hash.end(), ",",
             [&](const auto& e) {
                 // Use ConstantExpression::cppValue / javaValue
                 // because Java used signed byte for uint8_t.
                 out << byteToString(ConstantExpression::ValueOf(ScalarType::Kind::KIND_UINT8, e));
             });
         out << "} /* ";
-        out << iface->getFileHash()->hexString();
+        out << Hash::hexString(hash);
         out << " */";
     });
 }
@@ -441,8 +448,6 @@ bool Interface::fillDebugMethod(Method *method) const {
     return true;
 }
 
-static std::map<std::string, Method *> gAllReservedMethods;
-
 bool Interface::addMethod(Method *method) {
     if (isIBase()) {
         if (!gAllReservedMethods.emplace(method->name(), method).second) {
@@ -460,46 +465,48 @@ bool Interface::addMethod(Method *method) {
     return true;
 }
 
-std::vector<const Reference<Type>*> Interface::getReferences() const {
-    std::vector<const Reference<Type>*> ret;
-
-    if (!isIBase()) {
-        ret.push_back(&mSuperType);
+// Calls func on all methods, in the order of methods().
+template <typename F>
+static status_t forEachMethod(const std::vector<Method*>& userMethods,
+                              const std::vector<Method*>& reservedMethods, F&& func) {
+    for (const auto* methods : {&userMethods, &reservedMethods}) {
+        for (const Method* method : *methods) {
+            status_t err = func(method);
+            if (err != OK) return err;
+        }
     }
+    return OK;
+}
 
-    for (const auto* method : methods()) {
-        const auto& references = method->getReferences();
-        ret.insert(ret.end(), references.begin(), references.end());
+status_t Interface::visitReferences(Visitor<const Reference<Type>*> func) const {
+    if (!isIBase()) {
+        status_t err = func(&mSuperType);
+        if (err != OK) return err;
     }
 
-    return ret;
+    return forEachMethod(mUserMethods, mReservedMethods,
+                         [&](const Method* method) { return method->forEachReference(func); });
 }
 
-std::vector<const ConstantExpression*> Interface::getConstantExpressions() const {
-    std::vector<const ConstantExpression*> ret;
-    for (const auto* method : methods()) {
-        const auto& retMethod = method->getConstantExpressions();
-        ret.insert(ret.end(), retMethod.begin(), retMethod.end());
-    }
-    return ret;
+status_t Interface::visitConstantExpressions(Visitor<const ConstantExpression*> func) const {
+    return forEachMethod(mUserMethods, mReservedMethods, [&](const Method* method) {
+        return method->forEachConstantExpression(func);
+    });
 }
 
-std::vector<const Reference<Type>*> Interface::getStrongReferences() const {
+status_t Interface::visitStrongReferences(Visitor<const Reference<Type>*> func) const {
     // Interface is a special case as a reference:
     // its definiton must be completed for extension but
     // not necessary for other references.
 
-    std::vector<const Reference<Type>*> ret;
     if (!isIBase()) {
-        ret.push_back(&mSuperType);
+        status_t err = func(&mSuperType);
+        if (err != OK) return err;
     }
 
-    for (const auto* method : methods()) {
-        const auto& references = method->getStrongReferences();
-        ret.insert(ret.end(), references.begin(), references.end());
-    }
-
-    return ret;
+    return forEachMethod(mUserMethods, mReservedMethods, [&](const Method* method) {
+        return method->forEachStrongReference(func);
+    });
 }
 
 status_t Interface::resolveInheritance() {
@@ -548,6 +555,10 @@ void Interface::getAlignmentAndSize(size_t* align, size_t* size) const {
     *size = 8;
 }
 
+size_t Interface::getParcelDataSizeHint() const {
+    return kParcelBinderObjectSize;
+}
+
 status_t Interface::validateUniqueNames() const {
     std::unordered_map<std::string, const Interface*> registeredMethodNames;
     for (auto const& tuple : allSuperMethodsFromRoot()) {
@@ -20,14 +20,13 @@
 
 #include <vector>
 
-#include <hidl-hash/Hash.h>
-
 #include "ConstantExpression.h"
 #include "Reference.h"
 #include "Scope.h"
 
 namespace android {
 
+struct AST;
 struct Method;
 struct InterfaceAndMethod;
 
@@ -35,9 +34,7 @@ struct Interface : public Scope {
     const static std::unique_ptr<ConstantExpression> FLAG_ONE_WAY;
 
     Interface(const char* localName, const FQName& fullName, const Location& location,
-              Scope* parent, const Reference<Type>& superType, const Hash* fileHash);
-
-    const Hash* getFileHash() const;
+              Scope* parent, const Reference<Type>& superType, const AST* ast);
 
     bool addMethod(Method *method);
     bool addAllReservedMethods();
@@ -93,10 +90,10 @@ struct Interface : public Scope {
     std::string getJavaType(bool forInitializer) const override;
     std::string getVtsType() const override;
 
-    std::vector<const Reference<Type>*> getReferences() const override;
-    std::vector<const Reference<Type>*> getStrongReferences() const override;
+    status_t visitReferences(Visitor<const Reference<Type>*> func) const override;
+    status_t visitStrongReferences(Visitor<const Reference<Type>*> func) const override;
 
-    std::vector<const ConstantExpression*> getConstantExpressions() const override;
+    status_t visitConstantExpressions(Visitor<const ConstantExpression*> func) const override;
 
     status_t resolveInheritance() override;
     status_t validate() const override;
@@ -116,6 +113,8 @@ struct Interface : public Scope {
     void emitTypeDefinitions(Formatter& out, const std::string& prefix) const override;
 
     void getAlignmentAndSize(size_t* align, size_t* size) const override;
+
+    size_t getParcelDataSizeHint() const override;
     void emitJavaReaderWriter(
             Formatter &out,
             const std::string &parcelObj,
@@ -139,7 +138,8 @@ struct Interface : public Scope {
     std::vector<Method*> mUserMethods;
     std::vector<Method*> mReservedMethods;
 
-    const Hash* mFileHash;
+    // The AST which defines this interface, whose hash is in the hash chain.
+    const AST* mAST;
 
     bool fillPingMethod(Method* method) const;
     bool fillDescriptorChainMethod(Method* method) const;
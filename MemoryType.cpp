@@ -155,6 +155,15 @@ void MemoryType::getAlignmentAndSize(size_t *align, size_t *size) const {
     *size = assertion.size();
 }
 
+size_t MemoryType::getParcelDataSizeHint() const {
+    return kParcelBufferObjectSize + getEmbeddedParcelDataSizeHint();
+}
+
+// The handle and the name.
+size_t MemoryType::getEmbeddedParcelDataSizeHint() const {
+    return kParcelBufferObjectSize + kParcelFdArrayObjectSize + kParcelBufferObjectSize;
+}
+
 void MemoryType::emitVtsTypeDeclarations(Formatter& out) const {
     out << "type: " << getVtsType() << "\n";
 }
@@ -63,6 +63,9 @@ struct MemoryType : public Type {
 
     void getAlignmentAndSize(size_t *align, size_t *size) const override;
 
+    size_t getParcelDataSizeHint() const override;
+    size_t getEmbeddedParcelDataSizeHint() const override;
+
     void emitVtsTypeDeclarations(Formatter& out) const override;
 };
 
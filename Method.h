@@ -29,6 +29,7 @@
 #include <vector>
 
 #include "DocComment.h"
+#include "FunctionRef.h"
 #include "Location.h"
 #include "Reference.h"
 
@@ -67,14 +68,11 @@ struct Method : DocCommentable {
     bool isHidlReserved() const { return mIsHidlReserved; }
     const std::vector<Annotation *> &annotations() const;
 
-    std::vector<Reference<Type>*> getReferences();
-    std::vector<const Reference<Type>*> getReferences() const;
-
-    std::vector<Reference<Type>*> getStrongReferences();
-    std::vector<const Reference<Type>*> getStrongReferences() const;
-
-    std::vector<ConstantExpression*> getConstantExpressions();
-    std::vector<const ConstantExpression*> getConstantExpressions() const;
+    // See Type::forEachReference and friends.
+    status_t forEachReference(FunctionRef<status_t(const Reference<Type>*)> func) const;
+    status_t forEachStrongReference(FunctionRef<status_t(const Reference<Type>*)> func) const;
+    status_t forEachConstantExpression(
+        FunctionRef<status_t(const ConstantExpression*)> func) const;
 
     // Make a copy with the same name, args, results, oneway, annotations.
     // Implementations, serial are not copied.
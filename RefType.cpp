@@ -30,8 +30,8 @@ std::string RefType::templatedTypeName() const {
     return "ref";
 }
 
-std::vector<const Reference<Type>*> RefType::getStrongReferences() const {
-    return {};
+status_t RefType::visitStrongReferences(Visitor<const Reference<Type>*> /* func */) const {
+    return OK;
 }
 
 std::string RefType::getVtsType() const {
@@ -116,19 +116,20 @@ void Scope::setAnnotations(std::vector<Annotation*>* annotations) {
     mAnnotations = *annotations;
 }
 
-std::vector<const Type*> Scope::getDefinedTypes() const {
-    std::vector<const Type*> ret;
-    ret.insert(ret.end(), mTypes.begin(), mTypes.end());
-    return ret;
+status_t Scope::visitDefinedTypes(Visitor<const Type*> func) const {
+    for (const auto* type : mTypes) {
+        status_t err = func(type);
+        if (err != OK) return err;
+    }
+    return OK;
 }
 
-std::vector<const ConstantExpression*> Scope::getConstantExpressions() const {
-    std::vector<const ConstantExpression*> ret;
+status_t Scope::visitConstantExpressions(Visitor<const ConstantExpression*> func) const {
     for (const auto* annotation : mAnnotations) {
-        const auto& retAnnotation = annotation->getConstantExpressions();
-        ret.insert(ret.end(), retAnnotation.begin(), retAnnotation.end());
+        status_t err = annotation->forEachConstantExpression(func);
+        if (err != OK) return err;
     }
-    return ret;
+    return OK;
 }
 
 void Scope::topologicalReorder(const std::unordered_map<const Type*, size_t>& reversedOrder) {
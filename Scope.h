@@ -57,9 +57,9 @@ struct Scope : public NamedType {
 
     void setAnnotations(std::vector<Annotation*>* annotations);
 
-    std::vector<const Type*> getDefinedTypes() const override;
+    status_t visitDefinedTypes(Visitor<const Type*> func) const override;
 
-    std::vector<const ConstantExpression*> getConstantExpressions() const override;
+    status_t visitConstantExpressions(Visitor<const ConstantExpression*> func) const override;
 
     void topologicalReorder(const std::unordered_map<const Type*, size_t>& reversedOrder);
 
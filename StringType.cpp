@@ -222,5 +222,13 @@ void StringType::getAlignmentAndSize(size_t *align, size_t *size) const {
     *size = assertion.size();
 }
 
+size_t StringType::getParcelDataSizeHint() const {
+    return kParcelBufferObjectSize;
+}
+
+size_t StringType::getEmbeddedParcelDataSizeHint() const {
+    return kParcelBufferObjectSize;
+}
+
 }  // namespace android
 
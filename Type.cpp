@@ -100,58 +100,58 @@ const Type* Type::resolve() const {
     return this;
 }
 
-std::vector<Type*> Type::getDefinedTypes() {
-    const auto& constRet = static_cast<const Type*>(this)->getDefinedTypes();
-    std::vector<Type*> ret(constRet.size());
-    std::transform(constRet.begin(), constRet.end(), ret.begin(),
-                   [](const auto* type) { return const_cast<Type*>(type); });
-    return ret;
+status_t Type::forEachDefinedType(Visitor<Type*> func) {
+    return visitDefinedTypes([&](const Type* type) { return func(const_cast<Type*>(type)); });
 }
 
-std::vector<const Type*> Type::getDefinedTypes() const {
-    return {};
+status_t Type::forEachDefinedType(Visitor<const Type*> func) const {
+    return visitDefinedTypes(func);
 }
 
-std::vector<Reference<Type>*> Type::getReferences() {
-    const auto& constRet = static_cast<const Type*>(this)->getReferences();
-    std::vector<Reference<Type>*> ret(constRet.size());
-    std::transform(constRet.begin(), constRet.end(), ret.begin(),
-                   [](const auto* ref) { return const_cast<Reference<Type>*>(ref); });
-    return ret;
+status_t Type::visitDefinedTypes(Visitor<const Type*> /* func */) const {
+    return OK;
 }
 
-std::vector<const Reference<Type>*> Type::getReferences() const {
-    return {};
+status_t Type::forEachReference(Visitor<Reference<Type>*> func) {
+    return visitReferences(
+        [&](const Reference<Type>* ref) { return func(const_cast<Reference<Type>*>(ref)); });
 }
 
-std::vector<ConstantExpression*> Type::getConstantExpressions() {
-    const auto& constRet = static_cast<const Type*>(this)->getConstantExpressions();
-    std::vector<ConstantExpression*> ret(constRet.size());
-    std::transform(constRet.begin(), constRet.end(), ret.begin(),
-                   [](const auto* ce) { return const_cast<ConstantExpression*>(ce); });
-    return ret;
+status_t Type::forEachReference(Visitor<const Reference<Type>*> func) const {
+    return visitReferences(func);
 }
 
-std::vector<const ConstantExpression*> Type::getConstantExpressions() const {
-    return {};
+status_t Type::visitReferences(Visitor<const Reference<Type>*> /* func */) const {
+    return OK;
 }
 
-std::vector<Reference<Type>*> Type::getStrongReferences() {
-    const auto& constRet = static_cast<const Type*>(this)->getStrongReferences();
-    std::vector<Reference<Type>*> ret(constRet.size());
-    std::transform(constRet.begin(), constRet.end(), ret.begin(),
-                   [](const auto* ref) { return const_cast<Reference<Type>*>(ref); });
-    return ret;
+status_t Type::forEachConstantExpression(Visitor<ConstantExpression*> func) {
+    return visitConstantExpressions(
+        [&](const ConstantExpression* ce) { return func(const_cast<ConstantExpression*>(ce)); });
 }
 
-std::vector<const Reference<Type>*> Type::getStrongReferences() const {
-    std::vector<const Reference<Type>*> ret;
-    for (const auto* ref : getReferences()) {
-        if (!ref->shallowGet()->isNeverStrongReference()) {
-            ret.push_back(ref);
-        }
-    }
-    return ret;
+status_t Type::forEachConstantExpression(Visitor<const ConstantExpression*> func) const {
+    return visitConstantExpressions(func);
+}
+
+status_t Type::visitConstantExpressions(Visitor<const ConstantExpression*> /* func */) const {
+    return OK;
+}
+
+status_t Type::forEachStrongReference(Visitor<Reference<Type>*> func) {
+    return visitStrongReferences(
+        [&](const Reference<Type>* ref) { return func(const_cast<Reference<Type>*>(ref)); });
+}
+
+status_t Type::forEachStrongReference(Visitor<const Reference<Type>*> func) const {
+    return visitStrongReferences(func);
+}
+
+status_t Type::visitStrongReferences(Visitor<const Reference<Type>*> func) const {
+    return forEachReference([&](const Reference<Type>* ref) -> status_t {
+        if (ref->shallowGet()->isNeverStrongReference()) return OK;
+        return func(ref);
+    });
 }
 
 status_t Type::recursivePass(ParseStage stage, const std::function<status_t(Type*)>& func,
@@ -165,17 +165,13 @@ status_t Type::recursivePass(ParseStage stage, const std::function<status_t(Type
     status_t err = func(this);
     if (err != OK) return err;
 
-    for (auto* nextType : getDefinedTypes()) {
-        err = nextType->recursivePass(stage, func, visited);
-        if (err != OK) return err;
-    }
-
-    for (auto* nextRef : getReferences()) {
-        err = nextRef->shallowGet()->recursivePass(stage, func, visited);
-        if (err != OK) return err;
-    }
+    err = forEachDefinedType(
+        [&](Type* nextType) { return nextType->recursivePass(stage, func, visited); });
+    if (err != OK) return err;
 
-    return OK;
+    return forEachReference([&](Reference<Type>* nextRef) {
+        return nextRef->shallowGet()->recursivePass(stage, func, visited);
+    });
 }
 
 status_t Type::recursivePass(ParseStage stage, const std::function<status_t(const Type*)>& func,
@@ -189,17 +185,43 @@ status_t Type::recursivePass(ParseStage stage, const std::function<status_t(cons
     status_t err = func(this);
     if (err != OK) return err;
 
-    for (const auto* nextType : getDefinedTypes()) {
-        err = nextType->recursivePass(stage, func, visited);
-        if (err != OK) return err;
+    err = forEachDefinedType(
+        [&](const Type* nextType) { return nextType->recursivePass(stage, func, visited); });
+    if (err != OK) return err;
+
+    return forEachReference([&](const Reference<Type>* nextRef) {
+        return nextRef->shallowGet()->recursivePass(stage, func, visited);
+    });
+}
+
+status_t Type::recursivePasses(ParseStage stage,
+                               const std::vector<std::function<status_t(Type*)>>& passes,
+                               std::vector<bool>* visited, size_t* nextPassIndex) {
+    if (mParseStage > stage) return OK;
+    if (mParseStage < stage) return UNKNOWN_ERROR;
+
+    if (mPassIndex == kNoPassIndex) {
+        mPassIndex = (*nextPassIndex)++;
+    }
+    if (mPassIndex >= visited->size()) {
+        visited->resize(std::max(*nextPassIndex, 2 * visited->size()));
     }
+    if ((*visited)[mPassIndex]) return OK;
+    (*visited)[mPassIndex] = true;
 
-    for (const auto* nextRef : getReferences()) {
-        err = nextRef->shallowGet()->recursivePass(stage, func, visited);
+    for (const auto& pass : passes) {
+        status_t err = pass(this);
         if (err != OK) return err;
     }
 
-    return OK;
+    status_t err = forEachDefinedType([&](Type* nextType) {
+        return nextType->recursivePasses(stage, passes, visited, nextPassIndex);
+    });
+    if (err != OK) return err;
+
+    return forEachReference([&](Reference<Type>* nextRef) {
+        return nextRef->shallowGet()->recursivePasses(stage, passes, visited, nextPassIndex);
+    });
 }
 
 status_t Type::resolveInheritance() {
@@ -226,11 +248,17 @@ Type::CheckAcyclicStatus Type::topologicalOrder(
     if (reversedOrder->find(this) != reversedOrder->end()) return CheckAcyclicStatus(OK);
     stack->insert(this);
 
-    for (const auto* nextType : getDefinedTypes()) {
+    // The status of a failed child, returned once iteration stopped.
+    CheckAcyclicStatus result(OK);
+
+    forEachDefinedType([&](const Type* nextType) -> status_t {
         auto err = nextType->topologicalOrder(reversedOrder, stack);
 
         if (err.status != OK) {
-            if (err.cycleEnd == nullptr) return err;
+            if (err.cycleEnd == nullptr) {
+                result = err;
+                return err.status;
+            }
 
             std::cerr << "  '" << nextType->typeName() << "' in '" << typeName() << "'";
             if (nextType->isNamedType()) {
@@ -238,29 +266,32 @@ Type::CheckAcyclicStatus Type::topologicalOrder(
             }
             std::cerr << "\n";
 
-            if (err.cycleEnd == this) {
-                return CheckAcyclicStatus(err.status);
-            }
-            return err;
+            result = err.cycleEnd == this ? CheckAcyclicStatus(err.status) : err;
+            return err.status;
         }
-    }
+        return OK;
+    });
+    if (result.status != OK) return result;
 
-    for (const auto* nextRef : getStrongReferences()) {
+    forEachStrongReference([&](const Reference<Type>* nextRef) -> status_t {
         const auto* nextType = nextRef->shallowGet();
         auto err = nextType->topologicalOrder(reversedOrder, stack);
 
         if (err.status != OK) {
-            if (err.cycleEnd == nullptr) return err;
+            if (err.cycleEnd == nullptr) {
+                result = err;
+                return err.status;
+            }
 
             std::cerr << "  '" << nextType->typeName() << "' in '" << typeName() << "' at "
                       << nextRef->location() << "\n";
 
-            if (err.cycleEnd == this) {
-                return CheckAcyclicStatus(err.status);
-            }
-            return err;
+            result = err.cycleEnd == this ? CheckAcyclicStatus(err.status) : err;
+            return err.status;
         }
-    }
+        return OK;
+    });
+    if (result.status != OK) return result;
 
     CHECK(stack->find(this) != stack->end());
     stack->erase(this);
@@ -286,11 +317,9 @@ status_t Type::checkForwardReferenceRestrictions(const Reference<Type>& ref) con
     // If we support named templated types one day, we will need to change
     // this logic.
     if (!refType->isNamedType()) {
-        for (const Reference<Type>* innerRef : refType->getReferences()) {
-            status_t err = checkForwardReferenceRestrictions(*innerRef);
-            if (err != OK) return err;
-        }
-        return OK;
+        return refType->forEachReference([&](const Reference<Type>* innerRef) {
+            return checkForwardReferenceRestrictions(*innerRef);
+        });
     }
 
     const Location& typeLoc = static_cast<const NamedType*>(refType)->location();
@@ -463,6 +492,18 @@ void Type::emitDumpWithMethod(
         << ");\n";
 }
 
+void Type::emitAppendToString(
+        Formatter &out,
+        size_t /* depth */,
+        const std::string &streamName,
+        const std::string &name) const {
+    emitDump(out, "*" + streamName, name);
+}
+
+bool Type::hasAppendToString() const {
+    return false;
+}
+
 void Type::emitJavaDump(
         Formatter &out,
         const std::string &streamName,
@@ -751,6 +792,25 @@ void Type::getAlignmentAndSize(
     CHECK(!"Should not be here.");
 }
 
+size_t Type::getParcelDataSizeHint() const {
+    if (!isScalar() && !isEnum() && !isBitField()) {
+        return 0;
+    }
+
+    // Scalars are padded to 4 bytes.
+    size_t align, size;
+    getAlignmentAndSize(&align, &size);
+    return (size + 3) & ~static_cast<size_t>(3);
+}
+
+size_t Type::getEmbeddedParcelDataSizeHint() const {
+    return 0;
+}
+
+void Type::appendParcelDataSizeHintTerms(
+        const std::string & /* name */, std::vector<std::string> * /* terms */) const {
+}
+
 void Type::appendToExportedTypesVector(
         std::vector<const Type *> * /* exportedTypes */) const {
 }
@@ -785,8 +845,8 @@ bool TemplatedType::isTemplatedType() const {
     return true;
 }
 
-std::vector<const Reference<Type>*> TemplatedType::getReferences() const {
-    return {&mElementType};
+status_t TemplatedType::visitReferences(Visitor<const Reference<Type>*> func) const {
+    return func(&mElementType);
 }
 
 status_t TemplatedType::validate() const {
@@ -27,6 +27,7 @@
 #include <vector>
 
 #include "DocComment.h"
+#include "FunctionRef.h"
 #include "Reference.h"
 
 namespace android {
@@ -61,22 +62,27 @@ struct Type : DocCommentable {
     Type* resolve();
     virtual const Type* resolve() const;
 
+    // Callbacks for the forEach functions below. Iteration stops at the
+    // first callback which does not return OK, and that status is returned.
+    template <typename T>
+    using Visitor = FunctionRef<status_t(T)>;
+
     // All types defined in this type.
-    std::vector<Type*> getDefinedTypes();
-    virtual std::vector<const Type*> getDefinedTypes() const;
+    status_t forEachDefinedType(Visitor<Type*> func);
+    status_t forEachDefinedType(Visitor<const Type*> func) const;
 
     // All types referenced in this type.
-    std::vector<Reference<Type>*> getReferences();
-    virtual std::vector<const Reference<Type>*> getReferences() const;
+    status_t forEachReference(Visitor<Reference<Type>*> func);
+    status_t forEachReference(Visitor<const Reference<Type>*> func) const;
 
     // All constant expressions referenced in this type.
-    std::vector<ConstantExpression*> getConstantExpressions();
-    virtual std::vector<const ConstantExpression*> getConstantExpressions() const;
+    status_t forEachConstantExpression(Visitor<ConstantExpression*> func);
+    status_t forEachConstantExpression(Visitor<const ConstantExpression*> func) const;
 
     // All types referenced in this type that must have completed
     // definiton before being referenced.
-    std::vector<Reference<Type>*> getStrongReferences();
-    virtual std::vector<const Reference<Type>*> getStrongReferences() const;
+    status_t forEachStrongReference(Visitor<Reference<Type>*> func);
+    status_t forEachStrongReference(Visitor<const Reference<Type>*> func) const;
 
     // Indicate stage of parsing.
     enum class ParseStage {
@@ -98,6 +104,16 @@ struct Type : DocCommentable {
     status_t recursivePass(ParseStage stage, const std::function<status_t(const Type*)>& func,
                            std::unordered_set<const Type*>* visited) const;
 
+    // Like recursivePass, but runs several passes at once: all of them are
+    // run, in order, on a type before any other type is visited.
+    // Types are marked in visited by their pass index, which is assigned
+    // from *nextPassIndex the first time a type is visited. Only types in
+    // stage are visited, and those all belong to one AST, so indices are
+    // dense per AST.
+    status_t recursivePasses(ParseStage stage,
+                             const std::vector<std::function<status_t(Type*)>>& passes,
+                             std::vector<bool>* visited, size_t* nextPassIndex);
+
     // Recursive tree pass that completes type declarations
     // that depend on super types
     virtual status_t resolveInheritance();
@@ -121,7 +137,7 @@ struct Type : DocCommentable {
     // Recursive tree pass that ensures that type definitions and references
     // are acyclic and builds reversed topological order of the types.
     // If some cases allow using of incomplete types, these cases are to be
-    // declared in Type::getStrongReferences.
+    // declared in Type::forEachStrongReference.
     CheckAcyclicStatus topologicalOrder(std::unordered_map<const Type*, size_t>* reversedOrder,
                                         std::unordered_set<const Type*>* stack) const;
 
@@ -244,6 +260,17 @@ struct Type : DocCommentable {
             const std::string &streamName,
             const std::string &name) const;
 
+    // Emits code appending the same string emitDump does to the std::string
+    // streamName points to. Types which contain structs or unions do so in
+    // place, see hasAppendToString, others append the result of toString.
+    virtual void emitAppendToString(
+            Formatter &out,
+            size_t depth,
+            const std::string &streamName,
+            const std::string &name) const;
+
+    virtual bool hasAppendToString() const;
+
     virtual void emitJavaDump(
             Formatter &out,
             const std::string &streamName,
@@ -334,6 +361,19 @@ struct Type : DocCommentable {
 
     virtual void getAlignmentAndSize(size_t *align, size_t *size) const;
 
+    // Estimate of the bytes writing a value of this type adds to a parcel's
+    // data. hwbinder sends buffers by reference, so this is mostly scalars
+    // and the objects which refer to buffers, file descriptors and binders.
+    virtual size_t getParcelDataSizeHint() const;
+
+    // Same for a value embedded in a buffer, whose scalars are in the buffer.
+    virtual size_t getEmbeddedParcelDataSizeHint() const;
+
+    // Appends C++ expressions for the part of the estimate which depends on
+    // the value of name, e.x. on the number of elements of a vec.
+    virtual void appendParcelDataSizeHintTerms(
+            const std::string &name, std::vector<std::string> *terms) const;
+
     virtual void appendToExportedTypesVector(
             std::vector<const Type *> *exportedTypes) const;
 
@@ -342,6 +382,13 @@ struct Type : DocCommentable {
     virtual bool isNeverStrongReference() const;
 
    protected:
+    // Implementations of the forEach functions, overridden by types which
+    // have children of that kind.
+    virtual status_t visitDefinedTypes(Visitor<const Type*> func) const;
+    virtual status_t visitReferences(Visitor<const Reference<Type>*> func) const;
+    virtual status_t visitConstantExpressions(Visitor<const ConstantExpression*> func) const;
+    virtual status_t visitStrongReferences(Visitor<const Reference<Type>*> func) const;
+
     void handleError(Formatter &out, ErrorMode mode) const;
 
     void emitReaderWriterEmbeddedForTypeName(
@@ -372,8 +419,17 @@ struct Type : DocCommentable {
             const std::string &methodName,
             const std::string &name) const;
 
+    // Sizes of the objects hwbinder writes to a parcel's data for a buffer,
+    // an array of file descriptors and a binder.
+    static constexpr size_t kParcelBufferObjectSize = 40;
+    static constexpr size_t kParcelFdArrayObjectSize = 32;
+    static constexpr size_t kParcelBinderObjectSize = 24;
+
    private:
+    static constexpr size_t kNoPassIndex = SIZE_MAX;
+
     ParseStage mParseStage = ParseStage::PARSE;
+    size_t mPassIndex = kNoPassIndex;  // see recursivePasses
     Scope* const mParent;
 
     DISALLOW_COPY_AND_ASSIGN(Type);
@@ -391,7 +447,7 @@ struct TemplatedType : public Type {
 
     virtual bool isCompatibleElementType(const Type* elementType) const = 0;
 
-    std::vector<const Reference<Type>*> getReferences() const override;
+    status_t visitReferences(Visitor<const Reference<Type>*> func) const override;
 
     virtual status_t validate() const override;
 
@@ -59,8 +59,8 @@ const Type* TypeDef::resolve() const {
     return mReferencedType.get();
 }
 
-std::vector<const Reference<Type>*> TypeDef::getReferences() const {
-    return {&mReferencedType};
+status_t TypeDef::visitReferences(Visitor<const Reference<Type>*> func) const {
+    return func(&mReferencedType);
 }
 
 bool TypeDef::needsEmbeddedReadWrite() const {
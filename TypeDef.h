@@ -41,7 +41,7 @@ struct TypeDef : public NamedType {
 
     const Type* resolve() const override;
 
-    std::vector<const Reference<Type>*> getReferences() const override;
+    status_t visitReferences(Visitor<const Reference<Type>*> func) const override;
 
     void emitTypeDeclarations(Formatter& out) const override;
 
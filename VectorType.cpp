@@ -82,8 +82,8 @@ bool VectorType::deepCanCheckEquality(std::unordered_set<const Type*>* visited)
     return mElementType->canCheckEquality(visited);
 }
 
-std::vector<const Reference<Type>*> VectorType::getStrongReferences() const {
-    return {};
+status_t VectorType::visitStrongReferences(Visitor<const Reference<Type>*> /* func */) const {
+    return OK;
 }
 
 std::string VectorType::getCppType(StorageMode mode,
@@ -718,6 +718,38 @@ void VectorType::EmitJavaFieldReaderWriterForElementType(
     out << "}\n";
 }
 
+// Same format as toString(const hidl_vec<T>&) in libhidl.
+void VectorType::emitAppendToString(
+        Formatter &out,
+        size_t depth,
+        const std::string &streamName,
+        const std::string &name) const {
+    if (!hasAppendToString()) {
+        Type::emitAppendToString(out, depth, streamName, name);
+        return;
+    }
+
+    std::string iteratorName = "_hidl_index_" + std::to_string(depth);
+
+    out << "*" << streamName << " += \"[\";\n"
+        << "*" << streamName << " += std::to_string(" << name << ".size());\n"
+        << "*" << streamName << " += \"]{\";\n";
+    out << "for (size_t " << iteratorName << " = 0; " << iteratorName << " < " << name
+        << ".size(); ++" << iteratorName << ") ";
+    out.block([&] {
+        out.sIf(iteratorName + " > 0", [&] {
+            out << "*" << streamName << " += \", \";\n";
+        }).endl();
+        mElementType->emitAppendToString(out, depth + 1, streamName,
+                                         name + "[" + iteratorName + "]");
+    }).endl();
+    out << "*" << streamName << " += \"}\";\n";
+}
+
+bool VectorType::hasAppendToString() const {
+    return mElementType->hasAppendToString();
+}
+
 bool VectorType::needsEmbeddedReadWrite() const {
     return true;
 }
@@ -772,5 +804,22 @@ void VectorType::getAlignmentAndSize(size_t *align, size_t *size) const {
     VectorType::getAlignmentAndSizeStatic(align, size);
 }
 
+size_t VectorType::getParcelDataSizeHint() const {
+    return kParcelBufferObjectSize + getEmbeddedParcelDataSizeHint();
+}
+
+// The elements, see appendParcelDataSizeHintTerms for what they refer to.
+size_t VectorType::getEmbeddedParcelDataSizeHint() const {
+    return kParcelBufferObjectSize;
+}
+
+void VectorType::appendParcelDataSizeHintTerms(
+        const std::string &name, std::vector<std::string> *terms) const {
+    const size_t elementSize = mElementType->getEmbeddedParcelDataSizeHint();
+    if (elementSize > 0) {
+        terms->push_back(name + ".size() * " + std::to_string(elementSize));
+    }
+}
+
 }  // namespace android
 
@@ -34,7 +34,7 @@ struct VectorType : public TemplatedType {
     std::string templatedTypeName() const override;
     bool isCompatibleElementType(const Type* elementType) const override;
 
-    std::vector<const Reference<Type>*> getStrongReferences() const override;
+    status_t visitStrongReferences(Visitor<const Reference<Type>*> func) const override;
 
     bool deepCanCheckEquality(std::unordered_set<const Type*>* visited) const override;
 
@@ -124,6 +124,14 @@ struct VectorType : public TemplatedType {
             const std::string &offset,
             bool isReader);
 
+    void emitAppendToString(
+            Formatter &out,
+            size_t depth,
+            const std::string &streamName,
+            const std::string &name) const override;
+
+    bool hasAppendToString() const override;
+
     bool needsEmbeddedReadWrite() const override;
     bool deepNeedsResolveReferences(std::unordered_set<const Type*>* visited) const override;
     bool resultNeedsDeref() const override;
@@ -133,6 +141,11 @@ struct VectorType : public TemplatedType {
 
     void getAlignmentAndSize(size_t *align, size_t *size) const override;
     static void getAlignmentAndSizeStatic(size_t *align, size_t *size);
+
+    size_t getParcelDataSizeHint() const override;
+    size_t getEmbeddedParcelDataSizeHint() const override;
+    void appendParcelDataSizeHintTerms(
+            const std::string &name, std::vector<std::string> *terms) const override;
  private:
     // Helper method for emitResolveReferences[Embedded].
     // Pass empty childName and childOffsetText if the original
@@ -1064,6 +1064,29 @@ void AST::generateProxyMethodSource(Formatter& out, const std::string& klassName
     }).endl().endl();
 }
 
+// An OK status is written to a reply as just its exception code.
+static constexpr size_t kStatusOkSize = 4;
+
+// Reserves the data of parcel before values are written to it, so that it
+// is not grown repeatedly for methods with many or large arguments. size is
+// what is written before the values. See Type::getParcelDataSizeHint.
+static void emitParcelDataCapacityHint(Formatter& out, const std::string& parcel, size_t size,
+                                       const std::vector<NamedReference<Type>*>& values,
+                                       bool addPrefixToName) {
+    std::vector<std::string> terms;
+    for (const auto& value : values) {
+        size += value->type().getParcelDataSizeHint();
+        value->type().appendParcelDataSizeHintTerms(
+                addPrefixToName ? ("_hidl_out_" + value->name()) : value->name(), &terms);
+    }
+
+    out << parcel << "setDataCapacity(" << size;
+    for (const std::string& term : terms) {
+        out << " + " << term;
+    }
+    out << ");\n";
+}
+
 void AST::generateStaticProxyMethodSource(Formatter& out, const std::string& klassName,
                                           const Method* method, const Interface* superInterface) const {
     if (method->isHidlReserved() && method->overridesCppImpl(IMPL_PROXY)) {
@@ -1115,6 +1138,11 @@ void AST::generateStaticProxyMethodSource(Formatter& out, const std::string& kla
     declareCppReaderLocals(
             out, method->results(), true /* forResults */);
 
+    // The interface token is written as a C string, padded to 4 bytes.
+    const size_t interfaceTokenSize = (getInterface()->fqName().string().size() + 1 + 3) & ~3;
+    emitParcelDataCapacityHint(out, "_hidl_data.", interfaceTokenSize, method->args(),
+                               false /* addPrefixToName */);
+
     out << "_hidl_err = _hidl_data.writeInterfaceToken(";
     out << klassName;
     out << "::descriptor);\n";
@@ -1562,6 +1590,8 @@ void AST::generateStaticStubMethodSource(Formatter& out, const FQName& fqName,
 
         out << ");\n\n";
 
+        emitParcelDataCapacityHint(out, "_hidl_reply->", kStatusOkSize, method->results(),
+                                   true /* addPrefixToName */);
         out << "::android::hardware::writeToParcel(::android::hardware::Status::ok(), "
             << "_hidl_reply);\n\n";
 
@@ -1627,6 +1657,8 @@ void AST::generateStaticStubMethodSource(Formatter& out, const FQName& fqName,
             out << "}\n";
             out << "_hidl_callbackCalled = true;\n\n";
 
+            emitParcelDataCapacityHint(out, "_hidl_reply->", kStatusOkSize, method->results(),
+                                       true /* addPrefixToName */);
             out << "::android::hardware::writeToParcel(::android::hardware::Status::ok(), "
                 << "_hidl_reply);\n\n";
 
@@ -1932,17 +1964,17 @@ void AST::generateCppInstrumentationCall(
     out << "#ifdef __ANDROID_DEBUGGABLE__\n";
     out << "if (UNLIKELY(mEnableInstrumentation)) {\n";
     out.indent();
-    out << "std::vector<void *> _hidl_args;\n";
     std::string event_str = "";
+    // Pointers to the arguments or results, as passed to the callbacks.
+    std::vector<std::string> args;
     switch (event) {
         case SERVER_API_ENTRY:
         {
             event_str = "InstrumentationEvent::SERVER_API_ENTRY";
             for (const auto &arg : method->args()) {
-                out << "_hidl_args.push_back((void *)"
-                    << (arg->type().resultNeedsDeref() ? "" : "&")
-                    << arg->name()
-                    << ");\n";
+                args.push_back(std::string("(void *)")
+                    + (arg->type().resultNeedsDeref() ? "" : "&")
+                    + arg->name());
             }
             break;
         }
@@ -1950,9 +1982,7 @@ void AST::generateCppInstrumentationCall(
         {
             event_str = "InstrumentationEvent::SERVER_API_EXIT";
             for (const auto &arg : method->results()) {
-                out << "_hidl_args.push_back((void *)&_hidl_out_"
-                    << arg->name()
-                    << ");\n";
+                args.push_back("(void *)&_hidl_out_" + arg->name());
             }
             break;
         }
@@ -1960,9 +1990,7 @@ void AST::generateCppInstrumentationCall(
         {
             event_str = "InstrumentationEvent::CLIENT_API_ENTRY";
             for (const auto &arg : method->args()) {
-                out << "_hidl_args.push_back((void *)&"
-                    << arg->name()
-                    << ");\n";
+                args.push_back("(void *)&" + arg->name());
             }
             break;
         }
@@ -1970,11 +1998,10 @@ void AST::generateCppInstrumentationCall(
         {
             event_str = "InstrumentationEvent::CLIENT_API_EXIT";
             for (const auto &arg : method->results()) {
-                out << "_hidl_args.push_back((void *)"
-                    << (arg->type().resultNeedsDeref() ? "" : "&")
-                    << "_hidl_out_"
-                    << arg->name()
-                    << ");\n";
+                args.push_back(std::string("(void *)")
+                    + (arg->type().resultNeedsDeref() ? "" : "&")
+                    + "_hidl_out_"
+                    + arg->name());
             }
             break;
         }
@@ -1982,9 +2009,7 @@ void AST::generateCppInstrumentationCall(
         {
             event_str = "InstrumentationEvent::PASSTHROUGH_ENTRY";
             for (const auto &arg : method->args()) {
-                out << "_hidl_args.push_back((void *)&"
-                    << arg->name()
-                    << ");\n";
+                args.push_back("(void *)&" + arg->name());
             }
             break;
         }
@@ -1992,9 +2017,7 @@ void AST::generateCppInstrumentationCall(
         {
             event_str = "InstrumentationEvent::PASSTHROUGH_EXIT";
             for (const auto &arg : method->results()) {
-                out << "_hidl_args.push_back((void *)&_hidl_out_"
-                    << arg->name()
-                    << ");\n";
+                args.push_back("(void *)&_hidl_out_" + arg->name());
             }
             break;
         }
@@ -2004,6 +2027,26 @@ void AST::generateCppInstrumentationCall(
         }
     }
 
+    // The arguments are collected on the stack, since their number is known.
+    // The vector the callbacks take is borrowed from a pool of this thread,
+    // one per nesting depth, so that it is only allocated while the pool
+    // grows, and an instrumented call made by a callback uses another one.
+    if (args.empty()) {
+        out << "std::vector<void *> _hidl_args;\n";
+    } else {
+        out << "void *_hidl_args_array[] = {";
+        out.join(args.begin(), args.end(), ", ", [&](const std::string& arg) { out << arg; });
+        out << "};\n";
+        out << "static thread_local std::vector<std::vector<void *>> _hidl_args_pool;\n";
+        out << "static thread_local size_t _hidl_args_depth = 0;\n";
+        out.sIf("_hidl_args_pool.size() == _hidl_args_depth", [&] {
+            out << "_hidl_args_pool.emplace_back();\n";
+        }).endl();
+        out << "std::vector<void *> _hidl_args = std::move(_hidl_args_pool[_hidl_args_depth++]);\n";
+        out << "_hidl_args.assign(_hidl_args_array, _hidl_args_array + " << args.size()
+            << ");\n";
+    }
+
     out << "for (const auto &callback: mInstrumentationCallbacks) {\n";
     out.indent();
     out << "callback("
@@ -2019,6 +2062,10 @@ void AST::generateCppInstrumentationCall(
         << "\", &_hidl_args);\n";
     out.unindent();
     out << "}\n";
+    if (!args.empty()) {
+        // Returned with its capacity, the pool may have grown meanwhile.
+        out << "_hidl_args_pool[--_hidl_args_depth] = std::move(_hidl_args);\n";
+    }
     out.unindent();
     out << "}\n";
     out << "#endif // __ANDROID_DEBUGGABLE__\n\n";
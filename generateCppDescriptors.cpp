@@ -0,0 +1,293 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AST.h"
+
+#include "ArrayType.h"
+#include "CompoundType.h"
+#include "Interface.h"
+#include "Method.h"
+#include "Reference.h"
+#include "Scope.h"
+
+#include <android-base/logging.h>
+#include <hidl-util/Formatter.h>
+#include <hidl-util/StringHelper.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace android {
+
+static const std::string kDetails = "::android::hardware::details::";
+
+// Shared by all generated descriptor headers, so it is guarded on its own.
+static void emitDescriptorDefinitions(Formatter& out) {
+    out << "#ifndef HIDL_GENERATED_DESCRIPTOR_DEFINITIONS\n"
+        << "#define HIDL_GENERATED_DESCRIPTOR_DEFINITIONS\n\n";
+
+    out << "namespace android {\n"
+        << "namespace hardware {\n"
+        << "namespace details {\n\n";
+
+    out << "// Kinds of types, named as in VTS.\n";
+    out << "enum class hidl_descriptor_kind : uint8_t ";
+    out.block([&] {
+        for (const char* kind :
+             {"SCALAR", "ENUM", "MASK", "STRING", "VECTOR", "ARRAY", "STRUCT", "UNION",
+              "SAFE_UNION", "HANDLE", "HIDL_MEMORY", "FMQ_SYNC", "FMQ_UNSYNC", "HIDL_INTERFACE",
+              "HIDL_CALLBACK"}) {
+            out << kind << ",\n";
+        }
+    }) << ";\n\n";
+
+    out << "struct hidl_field_descriptor;\n\n";
+
+    out << "// Layout of a type in memory.\n";
+    out << "struct hidl_type_descriptor ";
+    out.block([&] {
+        out << "hidl_descriptor_kind kind;\n"
+            << "uint32_t size;\n"
+            << "uint32_t align;\n"
+            << "// VECTOR and ARRAY: the type of the elements, and the number of them\n"
+            << "// in an ARRAY (of all dimensions).\n"
+            << "const hidl_type_descriptor* element;\n"
+            << "uint32_t elementCount;\n"
+            << "// STRUCT, UNION and SAFE_UNION: the fields.\n"
+            << "const hidl_field_descriptor* fields;\n"
+            << "uint32_t fieldCount;\n";
+    }) << ";\n\n";
+
+    out << "// A field of a type, or an argument or result of a method (at offset 0).\n";
+    out << "struct hidl_field_descriptor ";
+    out.block([&] {
+        out << "const char* name;\n"
+            << "uint32_t offset;\n"
+            << "const hidl_type_descriptor* type;\n";
+    }) << ";\n\n";
+
+    out << "struct hidl_method_descriptor ";
+    out.block([&] {
+        out << "const char* name;\n"
+            << "uint32_t serialId;\n"
+            << "bool oneway;\n"
+            << "const hidl_field_descriptor* args;\n"
+            << "uint32_t argCount;\n"
+            << "const hidl_field_descriptor* results;\n"
+            << "uint32_t resultCount;\n";
+    }) << ";\n\n";
+
+    out << "}  // namespace details\n"
+        << "}  // namespace hardware\n"
+        << "}  // namespace android\n\n";
+
+    out << "#endif  // HIDL_GENERATED_DESCRIPTOR_DEFINITIONS\n\n";
+}
+
+namespace {
+
+// Emits descriptors of types before those which refer to them, and each
+// type once. Generated names contain prefix, so that the headers of a
+// package, which share a namespace, can be included together.
+struct DescriptorEmitter {
+    DescriptorEmitter(Formatter& out, const std::string& prefix) : mOut(out), mPrefix(prefix) {}
+
+    // Names the descriptor of type, which is otherwise given a generated
+    // name. Must be called before it is emitted.
+    void setName(const Type* type, const std::string& name) { mGivenNames[type] = name; }
+
+    // Returns the name of the descriptor of type, emitting it if needed.
+    std::string emit(const Type* type) {
+        auto it = mNames.find(type);
+        if (it != mNames.end()) return it->second;
+
+        auto given = mGivenNames.find(type);
+        const std::string descriptorName =
+                given != mGivenNames.end()
+                        ? given->second
+                        : "_hidl_" + mPrefix + "_descriptor_" + std::to_string(mNextId++);
+        // Reserved before recursing, so that no element is given the same name.
+        mNames[type] = descriptorName;
+
+        std::string element = "nullptr";
+        size_t elementCount = 0;
+        std::string fields = "nullptr";
+        size_t fieldCount = 0;
+
+        size_t align, size;
+        type->getAlignmentAndSize(&align, &size);
+
+        if (type->isVector()) {
+            element = "&" + emit(static_cast<const TemplatedType*>(type)->getElementType());
+        } else if (type->isArray()) {
+            const Type* elementType = static_cast<const ArrayType*>(type)->getElementType();
+            size_t elementAlign, elementSize;
+            elementType->getAlignmentAndSize(&elementAlign, &elementSize);
+            element = "&" + emit(elementType);
+            elementCount = size / elementSize;
+        } else if (type->isCompoundType()) {
+            const CompoundType* compound = static_cast<const CompoundType*>(type);
+            fieldCount = compound->getFields().size();
+            if (fieldCount > 0) {
+                fields = descriptorName + "_fields";
+                emitFields(fields, compound->getFields(), compound->getFieldOffsets());
+            }
+        }
+
+        CHECK(!type->getVtsType().empty()) << type->typeName();
+        const std::string kind = type->getVtsType().substr(strlen("TYPE_"));
+
+        mOut << "constexpr " << kDetails << "hidl_type_descriptor " << descriptorName << " = {"
+             << kDetails << "hidl_descriptor_kind::" << kind << ", " << size << ", " << align
+             << ", " << element << ", " << elementCount << ", " << fields << ", " << fieldCount
+             << "};\n";
+
+        return descriptorName;
+    }
+
+    // Emits an array of field descriptors named name, nothing if there are
+    // no fields.
+    void emitFields(const std::string& name, const std::vector<NamedReference<Type>*>& fields,
+                    const std::vector<size_t>& offsets) {
+        if (fields.empty()) return;
+
+        std::vector<std::string> types;
+        for (const NamedReference<Type>* field : fields) {
+            types.push_back(emit(&field->type()));
+        }
+
+        mOut << "constexpr " << kDetails << "hidl_field_descriptor " << name << "[] = ";
+        mOut.block([&] {
+            for (size_t i = 0; i < fields.size(); i++) {
+                mOut << "{\"" << fields[i]->name() << "\", " << offsets[i] << ", &" << types[i]
+                     << "},\n";
+            }
+        }) << ";\n";
+    }
+
+   private:
+    Formatter& mOut;
+    const std::string mPrefix;
+    size_t mNextId = 0;
+    std::map<const Type*, std::string> mGivenNames;
+    std::map<const Type*, std::string> mNames;
+};
+
+}  // namespace
+
+// Types which contain pointers have no fixed layout, and are left out.
+static void collectDescribedTypes(const Scope* scope, std::vector<const CompoundType*>* types) {
+    for (const NamedType* type : scope->getSubTypes()) {
+        if (type->isScope()) {
+            collectDescribedTypes(static_cast<const Scope*>(type), types);
+        }
+        if (type->isCompoundType() && !type->containsPointer()) {
+            types->push_back(static_cast<const CompoundType*>(type));
+        }
+    }
+}
+
+static bool canDescribe(const std::vector<NamedReference<Type>*>& values) {
+    for (const NamedReference<Type>* value : values) {
+        if (value->type().containsPointer() || value->type().getVtsType().empty()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void AST::generateCppDescriptorsHeader(Formatter& out) const {
+    const std::string name = AST::isInterface() ? getInterface()->localName() : "types";
+    const std::string guard = makeHeaderGuard(name + "Descriptors");
+
+    out << "#ifndef " << guard << "\n";
+    out << "#define " << guard << "\n\n";
+
+    out << "// Layouts of the types and the arguments of the methods in "
+        << mPackage.string() << "::" << name << ",\n"
+        << "// for marshalling them by walking these tables rather than by code\n"
+        << "// generated for each type.\n\n";
+
+    out << "#include <stdint.h>\n\n";
+
+    emitDescriptorDefinitions(out);
+
+    enterLeaveNamespace(out, true /* enter */);
+    out << "namespace hidl_descriptors {\n\n";
+
+    DescriptorEmitter emitter(out, name);
+
+    std::vector<const CompoundType*> types;
+    collectDescribedTypes(&mRootScope, &types);
+    for (const CompoundType* type : types) {
+        std::string name = type->fqName().name();
+        std::replace(name.begin(), name.end(), '.', '_');
+        emitter.setName(type, name);
+    }
+    for (const CompoundType* type : types) {
+        emitter.emit(type);
+    }
+
+    if (AST::isInterface()) {
+        const Interface* iface = getInterface();
+
+        std::vector<const Method*> methods;
+        for (const InterfaceAndMethod& tuple : iface->allMethodsFromRoot()) {
+            const Method* method = tuple.method();
+            if (method->isHidlReserved()) continue;
+            if (!canDescribe(method->args()) || !canDescribe(method->results())) {
+                out << "// " << method->name() << " has no fixed layout.\n";
+                continue;
+            }
+
+            const std::string prefix = iface->localName() + "_" + method->name();
+            const std::vector<size_t> offsets(
+                    std::max(method->args().size(), method->results().size()), 0);
+            emitter.emitFields(prefix + "_args", method->args(), offsets);
+            emitter.emitFields(prefix + "_results", method->results(), offsets);
+            methods.push_back(method);
+        }
+
+        out << "constexpr uint32_t " << iface->localName() << "_methodCount = " << methods.size()
+            << ";\n";
+
+        if (!methods.empty()) {
+            out << "// In transaction code order.\n";
+            out << "constexpr " << kDetails << "hidl_method_descriptor " << iface->localName()
+                << "_methods[] = ";
+            out.block([&] {
+                for (const Method* method : methods) {
+                    const std::string prefix = iface->localName() + "_" + method->name();
+                    out << "{\"" << method->name() << "\", " << method->getSerialId() << ", "
+                        << (method->isOneway() ? "true" : "false") << ", "
+                        << (method->args().empty() ? "nullptr" : prefix + "_args") << ", "
+                        << method->args().size() << ", "
+                        << (method->results().empty() ? "nullptr" : prefix + "_results") << ", "
+                        << method->results().size() << "},\n";
+                }
+            }) << ";\n";
+        }
+    }
+
+    out << "\n}  // namespace hidl_descriptors\n";
+    enterLeaveNamespace(out, false /* enter */);
+
+    out << "\n#endif  // " << guard << "\n";
+}
+
+}  // namespace android
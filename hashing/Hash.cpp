@@ -16,49 +16,148 @@
 
 #include <hidl-hash/Hash.h>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <algorithm>
-#include <fstream>
+#include <array>
+#include <atomic>
 #include <iomanip>
 #include <map>
-#include <regex>
+#include <mutex>
 #include <sstream>
+#include <string_view>
+#include <thread>
 
-#include <android-base/logging.h>
+#include <android-base/unique_fd.h>
 #include <openssl/sha.h>
 
 namespace android {
 
 const std::vector<uint8_t> Hash::kEmptyHash = std::vector<uint8_t>(SHA256_DIGEST_LENGTH, 0);
 
-Hash& Hash::getMutableHash(const std::string& path) {
-    static std::map<std::string, Hash> hashes;
+// guards the static caches below, which may be used from multiple threads.
+static std::mutex gCacheMutex;
 
-    auto it = hashes.find(path);
+std::map<std::string, Hash>& Hash::getCache() {
+    static std::map<std::string, Hash> hashes;
+    return hashes;
+}
 
-    if (hashes.find(path) == hashes.end()) {
-        it = hashes.insert(it, {path, Hash(path)});
+Hash& Hash::getMutableHash(const std::string& path) {
+    {
+        std::lock_guard<std::mutex> lock(gCacheMutex);
+        auto it = getCache().find(path);
+        if (it != getCache().end()) {
+            return it->second;
+        }
     }
 
-    return it->second;
+    // Hash the file without holding the lock. If another thread hashed it in
+    // the meantime, its result is kept.
+    Hash hash(path);
+
+    std::lock_guard<std::mutex> lock(gCacheMutex);
+    return getCache().insert({path, hash}).first->second;
 }
 
 const Hash& Hash::getHash(const std::string& path) {
     return getMutableHash(path);
 }
 
-void Hash::clearHash(const std::string& path) {
-    getMutableHash(path).mHash = kEmptyHash;
+std::vector<const Hash*> Hash::getHashes(const std::vector<std::string>& paths, size_t jobs) {
+    std::vector<const Hash*> hashes(paths.size());
+    std::atomic<size_t> next(0);
+
+    auto worker = [&] {
+        for (size_t i = next++; i < paths.size(); i = next++) {
+            hashes[i] = &getHash(paths[i]);
+        }
+    };
+
+    // This thread is one of the workers.
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < std::min(jobs, paths.size()); i++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    return hashes;
 }
 
-static std::vector<uint8_t> sha256File(const std::string& path) {
-    std::ifstream stream(path);
-    std::stringstream fileStream;
-    fileStream << stream.rdbuf();
-    std::string fileContent = fileStream.str();
+std::vector<uint8_t> Hash::sha256(const std::string& data) {
+    std::vector<uint8_t> ret = std::vector<uint8_t>(SHA256_DIGEST_LENGTH);
+
+    SHA256(reinterpret_cast<const uint8_t*>(data.c_str()), data.size(), ret.data());
+
+    return ret;
+}
 
+// Calls onChunk(chunk, isWholeFile) with the contents of the file at path,
+// in one chunk if the file can be mapped, so that it is not copied, or else
+// in chunks of up to 64 KiB as they are read. Chunks are only valid during
+// the call. Returns false if the file cannot be opened.
+template <typename F>
+static bool forEachFileChunk(const std::string& path, F&& onChunk) {
+    base::unique_fd fd(TEMP_FAILURE_RETRY(open(path.c_str(), O_RDONLY | O_CLOEXEC)));
+    struct stat st;
+    if (fd == -1 || fstat(fd, &st) != 0) {
+        return false;
+    }
+
+    void* data =
+        st.st_size > 0 ? mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    if (data != MAP_FAILED) {
+        onChunk(std::string_view(static_cast<const char*>(data), st.st_size),
+                true /* isWholeFile */);
+        munmap(data, st.st_size);
+        return true;
+    }
+
+    // e.x. pipes, which cannot be mapped.
+    char buffer[64 * 1024];
+    ssize_t size;
+    while ((size = TEMP_FAILURE_RETRY(read(fd, buffer, sizeof(buffer)))) > 0) {
+        onChunk(std::string_view(buffer, size), false /* isWholeFile */);
+    }
+    return true;
+}
+
+// Calls onContents with all of the contents of the file at path, which are
+// only copied if the file cannot be mapped. Returns false if the file
+// cannot be opened.
+template <typename F>
+static bool withFileContents(const std::string& path, F&& onContents) {
+    std::string contents;
+    bool calledWithWholeFile = false;
+    bool exists = forEachFileChunk(path, [&](std::string_view chunk, bool isWholeFile) {
+        if (isWholeFile) {
+            onContents(chunk);
+            calledWithWholeFile = true;
+        } else {
+            contents.append(chunk.data(), chunk.size());
+        }
+    });
+    if (exists && !calledWithWholeFile) {
+        onContents(std::string_view(contents));
+    }
+    return exists;
+}
+
+// A file which cannot be read hashes like an empty one.
+std::vector<uint8_t> Hash::sha256File(const std::string& path) {
     std::vector<uint8_t> ret = std::vector<uint8_t>(SHA256_DIGEST_LENGTH);
 
-    SHA256(reinterpret_cast<const uint8_t*>(fileContent.c_str()), fileContent.size(), ret.data());
+    SHA256_CTX context;
+    SHA256_Init(&context);
+    forEachFileChunk(path, [&](std::string_view chunk, bool /* isWholeFile */) {
+        SHA256_Update(&context, chunk.data(), chunk.size());
+    });
+    SHA256_Final(ret.data(), &context);
 
     return ret;
 }
@@ -86,79 +185,168 @@ const std::string& Hash::getPath() const {
     return mPath;
 }
 
-#define HASH "([0-9a-f]+)"
-#define FQNAME "([^\\s]+)"
-#define SPACES " +"
-#define MAYBE_SPACES " *"
-#define OPTIONAL_COMMENT "(?:#.*)?"
-static const std::regex kHashLine("(?:" MAYBE_SPACES HASH SPACES FQNAME MAYBE_SPACES
-                                  ")?" OPTIONAL_COMMENT);
+static bool isHashSpace(char c) {
+    return c == ' ';
+}
+
+// Same as \s in the regular expression this parser replaced.
+static bool isFqNameSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+}
+
+static bool isHashDigit(char c) {
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f');
+}
+
+// Parses a line of current.txt, which has the form
+//   [ *HASH +FQNAME *][#COMMENT]
+// where HASH is lower case hex and FQNAME has no white space. hash and
+// fqName are left empty for lines without them.
+static bool parseHashLine(std::string_view line, std::string_view* hash,
+                          std::string_view* fqName) {
+    size_t pos = 0;
+    auto skip = [&](auto predicate) {
+        size_t start = pos;
+        while (pos < line.size() && predicate(line[pos])) pos++;
+        return line.substr(start, pos - start);
+    };
+
+    // Comments run to the end of the line, but may not contain '\r'.
+    auto isComment = [&](size_t start) {
+        return line[start] == '#' && line.find('\r', start) == std::string_view::npos;
+    };
+
+    if (line.empty() || isComment(0)) return true;
+
+    skip(isHashSpace);
+    *hash = skip(isHashDigit);
+    if (hash->empty() || skip(isHashSpace).empty()) return false;
+    size_t fqNameStart = pos;
+    *fqName = skip([](char c) { return !isFqNameSpace(c); });
+    if (fqName->empty()) return false;
+    skip(isHashSpace);
+
+    if (pos == line.size() || isComment(pos)) return true;
+
+    // FQNAME may contain '#', so a comment may also start inside of it.
+    size_t comment = fqName->rfind('#');
+    if (comment == 0 || comment == std::string_view::npos ||
+        !isComment(fqNameStart + comment)) {
+        return false;
+    }
+    *fqName = fqName->substr(0, comment);
+    return true;
+}
+
+static bool parseHashDigits(std::string_view hex, uint8_t* out, size_t outSize) {
+    if (hex.size() != 2 * outSize) return false;
 
+    auto value = [](char c) { return c <= '9' ? c - '0' : c - 'a' + 10; };
+    for (size_t i = 0; i < outSize; i++) {
+        out[i] = value(hex[2 * i]) << 4 | value(hex[2 * i + 1]);
+    }
+    return true;
+}
+
+// Contents of a current.txt file. Immutable once read, so lookups need no
+// locking.
 struct HashFile {
     static const HashFile* parse(const std::string& path, std::string* err) {
-        static std::map<std::string, HashFile*> hashfiles;
-        auto it = hashfiles.find(path);
-
-        if (it == hashfiles.end()) {
-            it = hashfiles.insert(it, {path, readHashFile(path, err)});
+        {
+            std::lock_guard<std::mutex> lock(gCacheMutex);
+            auto it = getHashFiles().find(path);
+            if (it != getHashFiles().end()) {
+                return it->second;
+            }
         }
 
+        // Read the file without holding the lock. If another thread read it
+        // in the meantime, its result is kept.
+        HashFile* file = readHashFile(path, err);
+
+        std::lock_guard<std::mutex> lock(gCacheMutex);
+        auto [it, inserted] = getHashFiles().insert({path, file});
+        if (!inserted) {
+            delete file;
+        }
         return it->second;
     }
 
+    // Files which are forgotten are not deleted, lookupHash may still use them.
+    static void forget(const std::string& path) {
+        std::lock_guard<std::mutex> lock(gCacheMutex);
+        getHashFiles().erase(path);
+    }
+
     std::vector<std::string> lookup(const std::string& fqName) const {
-        auto it = hashes.find(fqName);
+        auto [begin, end] = std::equal_range(entries.begin(), entries.end(), fqName, Less());
 
-        if (it == hashes.end()) {
-            return {};
+        std::vector<std::string> hashes;
+        for (auto it = begin; it != end; ++it) {
+            hashes.push_back(
+                Hash::hexString(std::vector<uint8_t>(it->hash.begin(), it->hash.end())));
         }
-
-        return it->second;
+        return hashes;
     }
 
    private:
-    static HashFile* readHashFile(const std::string& path, std::string* err) {
-        std::ifstream stream(path);
-        if (!stream) {
-            return nullptr;
-        }
+    struct Entry {
+        std::string fqName;
+        std::array<uint8_t, SHA256_DIGEST_LENGTH> hash;
+    };
+
+    struct Less {
+        bool operator()(const Entry& a, const Entry& b) const { return a.fqName < b.fqName; }
+        bool operator()(const Entry& a, const std::string& b) const { return a.fqName < b; }
+        bool operator()(const std::string& a, const Entry& b) const { return a < b.fqName; }
+    };
+
+    static std::map<std::string, HashFile*>& getHashFiles() {
+        static std::map<std::string, HashFile*> hashfiles;
+        return hashfiles;
+    }
 
+    static HashFile* readHashFile(const std::string& path, std::string* err) {
         HashFile* file = new HashFile();
         file->path = path;
 
-        std::string line;
-        while (std::getline(stream, line)) {
-            std::smatch match;
-            bool valid = std::regex_match(line, match, kHashLine);
-
-            if (!valid) {
-                *err = "Error reading line from " + path + ": " + line;
-                delete file;
-                return nullptr;
+        bool valid = true;
+        bool exists = withFileContents(path, [&](std::string_view contents) {
+            while (valid && !contents.empty()) {
+                size_t end = contents.find('\n');
+                std::string_view line = contents.substr(0, end);
+                contents.remove_prefix(end == std::string_view::npos ? contents.size() : end + 1);
+
+                std::string_view hash;
+                std::string_view fqName;
+                if (!parseHashLine(line, &hash, &fqName)) {
+                    *err = "Error reading line from " + path + ": " + std::string(line);
+                    valid = false;
+                } else if (!hash.empty()) {
+                    Entry entry{std::string(fqName), {}};
+                    if (!parseHashDigits(hash, entry.hash.data(), entry.hash.size())) {
+                        *err = "Hash is not a sha256 on " + path + ": " + std::string(line);
+                        valid = false;
+                    } else {
+                        file->entries.push_back(std::move(entry));
+                    }
+                }
             }
+        });
 
-            CHECK_EQ(match.size(), 3u);
-
-            std::string hash = match.str(1);
-            std::string fqName = match.str(2);
-
-            if (hash.size() == 0 && fqName.size() == 0) {
-                continue;
-            }
-
-            if (hash.size() == 0 || fqName.size() == 0) {
-                *err = "Hash or fqName empty on " + path + ": " + line;
-                delete file;
-                return nullptr;
-            }
-
-            file->hashes[fqName].push_back(hash);
+        if (!exists || !valid) {
+            delete file;
+            return nullptr;
         }
+
+        // Hashes of an interface stay in file order.
+        std::stable_sort(file->entries.begin(), file->entries.end(), Less());
         return file;
     }
 
     std::string path;
-    std::map<std::string, std::vector<std::string>> hashes;
+    // Sorted by fqName.
+    std::vector<Entry> entries;
 };
 
 std::vector<std::string> Hash::lookupHash(const std::string& path, const std::string& interfaceName,
@@ -176,4 +364,16 @@ std::vector<std::string> Hash::lookupHash(const std::string& path, const std::st
     return file->lookup(interfaceName);
 }
 
+void Hash::invalidate(const std::string& path) {
+    HashFile::forget(path);
+
+    std::vector<uint8_t> hash = sha256File(path);
+
+    std::lock_guard<std::mutex> lock(gCacheMutex);
+    auto it = getCache().find(path);
+    if (it != getCache().end()) {
+        it->second.mHash = hash;
+    }
+}
+
 }  // namespace android
@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <map>
 #include <string>
 #include <vector>
 
@@ -26,7 +27,9 @@ struct Hash {
 
     // path to .hal file
     static const Hash& getHash(const std::string& path);
-    static void clearHash(const std::string& path);
+    // getHash for each of paths, hashing up to jobs files at once.
+    static std::vector<const Hash*> getHashes(const std::vector<std::string>& paths,
+                                              size_t jobs);
 
     // returns matching hashes of interfaceName in path
     // path is something like hardware/interfaces/current.txt
@@ -35,6 +38,16 @@ struct Hash {
                                                const std::string& interfaceName, std::string* err,
                                                bool* fileExists = nullptr);
 
+    // path (a .hal file or something like current.txt) was modified. Hashes
+    // returned by getHash for path are recomputed in place.
+    static void invalidate(const std::string& path);
+
+    // sha256 of data, e.x. to combine several hashes into one
+    static std::vector<uint8_t> sha256(const std::string& data);
+    // sha256 of the contents of path as they are now, not cached like
+    // getHash.
+    static std::vector<uint8_t> sha256File(const std::string& path);
+
     static std::string hexString(const std::vector<uint8_t>& hash);
     std::string hexString() const;
 
@@ -44,6 +57,7 @@ struct Hash {
    private:
     Hash(const std::string& path);
 
+    static std::map<std::string, Hash>& getCache();
     static Hash& getMutableHash(const std::string& path);
 
     const std::string mPath;
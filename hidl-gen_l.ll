@@ -55,12 +55,13 @@ FQNAME              ({COMPONENT}|{VERSION})(({DOT}|":"+){COMPONENT}|{VERSION})*
 using namespace android;
 using token = yy::parser::token;
 
-static std::string gCurrentComment;
+// Files may be parsed on multiple threads at once.
+static thread_local std::string gCurrentComment;
 
-#define SCALAR_TYPE(kind)                                        \
-    {                                                            \
-        yylval->type = new ScalarType(ScalarType::kind, *scope); \
-        return token::TYPE;                                      \
+#define SCALAR_TYPE(kind)                                                   \
+    {                                                                       \
+        yylval->type = yyextra->make<ScalarType>(ScalarType::kind, *scope); \
+        return token::TYPE;                                                 \
     }
 
 #define YY_DECL int yylex(YYSTYPE* yylval_param, YYLTYPE* yylloc_param,  \
@@ -77,6 +78,7 @@ static std::string gCurrentComment;
 %option reentrant
 %option bison-bridge
 %option bison-locations
+%option extra-type="android::AST*"
 
 %x COMMENT_STATE
 %x DOC_COMMENT_STATE
@@ -86,7 +88,7 @@ static std::string gCurrentComment;
 "/**"                       { gCurrentComment.clear(); BEGIN(DOC_COMMENT_STATE); }
 <DOC_COMMENT_STATE>"*/"     {
                                 BEGIN(INITIAL);
-                                yylval->docComment = new DocComment(gCurrentComment);
+                                yylval->docComment = yyextra->make<DocComment>(gCurrentComment);
                                 return token::DOC_COMMENT;
                             }
 <DOC_COMMENT_STATE>[^*\n]*                          { gCurrentComment += yytext; }
@@ -110,9 +112,9 @@ static std::string gCurrentComment;
 "struct"            { return token::STRUCT; }
 "typedef"           { return token::TYPEDEF; }
 "union"             { return token::UNION; }
-"bitfield"          { yylval->templatedType = new BitFieldType(*scope); return token::TEMPLATED; }
-"vec"               { yylval->templatedType = new VectorType(*scope); return token::TEMPLATED; }
-"ref"               { yylval->templatedType = new RefType(*scope); return token::TEMPLATED; }
+"bitfield"          { yylval->templatedType = yyextra->make<BitFieldType>(*scope); return token::TEMPLATED; }
+"vec"               { yylval->templatedType = yyextra->make<VectorType>(*scope); return token::TEMPLATED; }
+"ref"               { yylval->templatedType = yyextra->make<RefType>(*scope); return token::TEMPLATED; }
 "oneway"            { return token::ONEWAY; }
 
 "bool"              { SCALAR_TYPE(KIND_BOOL); }
@@ -127,14 +129,14 @@ static std::string gCurrentComment;
 "float"             { SCALAR_TYPE(KIND_FLOAT); }
 "double"            { SCALAR_TYPE(KIND_DOUBLE); }
 
-"death_recipient"   { yylval->type = new DeathRecipientType(*scope); return token::TYPE; }
-"handle"            { yylval->type = new HandleType(*scope); return token::TYPE; }
-"memory"            { yylval->type = new MemoryType(*scope); return token::TYPE; }
-"pointer"           { yylval->type = new PointerType(*scope); return token::TYPE; }
-"string"            { yylval->type = new StringType(*scope); return token::TYPE; }
+"death_recipient"   { yylval->type = yyextra->make<DeathRecipientType>(*scope); return token::TYPE; }
+"handle"            { yylval->type = yyextra->make<HandleType>(*scope); return token::TYPE; }
+"memory"            { yylval->type = yyextra->make<MemoryType>(*scope); return token::TYPE; }
+"pointer"           { yylval->type = yyextra->make<PointerType>(*scope); return token::TYPE; }
+"string"            { yylval->type = yyextra->make<StringType>(*scope); return token::TYPE; }
 
-"fmq_sync"          { yylval->type = new FmqType("::android::hardware", "MQDescriptorSync", *scope); return token::TEMPLATED; }
-"fmq_unsync"        { yylval->type = new FmqType("::android::hardware", "MQDescriptorUnsync", *scope); return token::TEMPLATED; }
+"fmq_sync"          { yylval->type = yyextra->make<FmqType>("::android::hardware", "MQDescriptorSync", *scope); return token::TEMPLATED; }
+"fmq_unsync"        { yylval->type = yyextra->make<FmqType>("::android::hardware", "MQDescriptorUnsync", *scope); return token::TEMPLATED; }
 
 "("                 { return('('); }
 ")"                 { return(')'); }
@@ -194,7 +196,8 @@ namespace android {
 
 status_t parseFile(AST* ast, std::unique_ptr<FILE, std::function<void(FILE *)>> file) {
     yyscan_t scanner;
-    yylex_init(&scanner);
+    // The AST owns everything the scanner makes, see AST::make.
+    yylex_init_extra(ast, &scanner);
 
     yyset_in(file.get(), scanner);
 
@@ -15,146 +15,202 @@
  */
 
 #include "Formatter.h"
+#include "Profiler.h"
 
 #include <assert.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <charconv>
 
+#include <android-base/file.h>
 #include <android-base/logging.h>
 
 namespace android {
 
-Formatter::Formatter() : mFile(nullptr /* invalid */), mIndentDepth(0), mAtStartOfLine(true) {}
+// Output to a FILE* is written out in chunks of about this size.
+static constexpr size_t kFlushThreshold = 64 * 1024;
+
+Formatter::Formatter()
+    : mFile(nullptr /* invalid */),
+      mTmpFile(nullptr),
+      mIndentDepth(0),
+      mAtStartOfLine(true) {}
 
 Formatter::Formatter(FILE* file, size_t spacesPerIndent)
     : mFile(file == nullptr ? stdout : file),
+      mTmpFile(nullptr),
       mIndentDepth(0),
       mSpacesPerIndent(spacesPerIndent),
-      mAtStartOfLine(true) {}
-
-Formatter::~Formatter() {
-    if (mFile != stdout) {
-        fclose(mFile);
-    }
-    mFile = nullptr;
-}
-
-void Formatter::indent(size_t level) {
-    mIndentDepth += level;
+      mAtStartOfLine(true) {
+    mBuffer.reserve(kFlushThreshold);
 }
 
-void Formatter::unindent(size_t level) {
-    assert(mIndentDepth >= level);
-    mIndentDepth -= level;
+Formatter::Formatter(const std::string& path, size_t spacesPerIndent)
+    : mFile(nullptr),
+      mPath(path),
+      mTmpFile(nullptr),
+      // Next to the file, so that it can be renamed over it.
+      mTmpPath(path + ".tmp." + std::to_string(getpid())),
+      mIndentDepth(0),
+      mSpacesPerIndent(spacesPerIndent),
+      mAtStartOfLine(true) {
+    mTmpFile = fopen(mTmpPath.c_str(), "w");
+    if (mTmpFile == nullptr) {
+        fprintf(stderr, "ERROR: could not create file %s: %d\n", mTmpPath.c_str(), errno);
+        mPath.clear();
+        mTmpPath.clear();
+    }
+    mBuffer.reserve(kFlushThreshold);
 }
 
-Formatter& Formatter::indent(size_t level, const std::function<void(void)>& func) {
-    this->indent(level);
-    func();
-    this->unindent(level);
-    return *this;
+Formatter::Formatter(Formatter&& other)
+    : mFile(other.mFile),
+      mPath(std::move(other.mPath)),
+      mTmpFile(other.mTmpFile),
+      mTmpPath(std::move(other.mTmpPath)),
+      mBuffer(std::move(other.mBuffer)),
+      mIndentDepth(other.mIndentDepth),
+      mSpacesPerIndent(other.mSpacesPerIndent),
+      mAtStartOfLine(other.mAtStartOfLine),
+      mSpace(std::move(other.mSpace)),
+      mLinePrefix(std::move(other.mLinePrefix)) {
+    other.mFile = nullptr;
+    other.mPath.clear();
+    other.mTmpFile = nullptr;
+    other.mTmpPath.clear();
+    other.mBuffer.clear();
 }
 
-Formatter& Formatter::indent(const std::function<void(void)>& func) {
-    return this->indent(1, func);
+Formatter::~Formatter() {
+    if (mTmpFile != nullptr) {
+        discard();
+    } else if (mFile != nullptr) {
+        flush();
+        if (mFile != stdout) {
+            fclose(mFile);
+        }
+    }
+    mFile = nullptr;
 }
 
-Formatter& Formatter::block(const std::function<void(void)>& func) {
-    (*this) << "{\n";
-    this->indent(func);
-    return (*this) << "}";
+bool Formatter::commit() {
+    bool success = true;
+    if (mTmpFile != nullptr) {
+        success = writeIfChanged();
+    } else if (mFile != nullptr) {
+        flush();
+        success = fflush(mFile) == 0 && !ferror(mFile);
+        if (mFile != stdout && fclose(mFile) != 0) {
+            success = false;
+        }
+        if (!success) {
+            fprintf(stderr, "ERROR: could not write output: %d\n", errno);
+        }
+    }
+    mFile = nullptr;
+    return success;
 }
 
-void Formatter::setLinePrefix(const std::string &prefix) {
-    mLinePrefix = prefix;
-}
+bool Formatter::writeIfChanged() {
+    Profiler::count(Profiler::Counter::BYTES_EMITTED, mBuffer.size());
 
-void Formatter::unsetLinePrefix() {
-    mLinePrefix = "";
-}
+    struct stat st;
+    if (stat(mPath.c_str(), &st) == 0 && static_cast<size_t>(st.st_size) == mBuffer.size()) {
+        std::string current;
+        if (base::ReadFileToString(mPath, &current) && current == mBuffer) {
+            discard();
+            return true;
+        }
+    }
 
-Formatter &Formatter::endl() {
-    return (*this) << "\n";
-}
+    const bool written = fwrite(mBuffer.data(), 1, mBuffer.size(), mTmpFile) == mBuffer.size();
+    const bool closed = fclose(mTmpFile) == 0;
+    mTmpFile = nullptr;
+    if (!written || !closed) {
+        fprintf(stderr, "ERROR: could not write file %s: %d\n", mTmpPath.c_str(), errno);
+        discard();
+        return false;
+    }
 
-Formatter& Formatter::sIf(const std::string& cond, const std::function<void(void)>& block) {
-    (*this) << "if (" << cond << ") ";
-    return this->block(block);
-}
+    if (rename(mTmpPath.c_str(), mPath.c_str()) != 0) {
+        fprintf(stderr, "ERROR: could not write file %s: %d\n", mPath.c_str(), errno);
+        discard();
+        return false;
+    }
 
-Formatter& Formatter::sElseIf(const std::string& cond, const std::function<void(void)>& block) {
-    (*this) << " else if (" << cond << ") ";
-    return this->block(block);
+    mPath.clear();
+    mTmpPath.clear();
+    return true;
 }
 
-Formatter& Formatter::sElse(const std::function<void(void)>& block) {
-    (*this) << " else ";
-    return this->block(block);
+void Formatter::discard() {
+    if (mTmpFile != nullptr) {
+        fclose(mTmpFile);
+        mTmpFile = nullptr;
+    }
+    if (!mTmpPath.empty()) {
+        unlink(mTmpPath.c_str());
+    }
+    mPath.clear();
+    mTmpPath.clear();
+    mBuffer.clear();
 }
 
-Formatter& Formatter::sFor(const std::string& stmts, const std::function<void(void)>& block) {
-    (*this) << "for (" << stmts << ") ";
-    return this->block(block);
+void Formatter::indent(size_t level) {
+    mIndentDepth += level;
 }
 
-Formatter& Formatter::sTry(const std::function<void(void)>& block) {
-    (*this) << "try ";
-    return this->block(block);
+void Formatter::unindent(size_t level) {
+    assert(mIndentDepth >= level);
+    mIndentDepth -= level;
 }
 
-Formatter& Formatter::sCatch(const std::string& exception, const std::function<void(void)>& block) {
-    (*this) << " catch (" << exception << ") ";
-    return this->block(block);
+void Formatter::setLinePrefix(const std::string &prefix) {
+    mLinePrefix = prefix;
 }
 
-Formatter& Formatter::sFinally(const std::function<void(void)>& block) {
-    (*this) << " finally ";
-    return this->block(block);
+void Formatter::unsetLinePrefix() {
+    mLinePrefix = "";
 }
 
-Formatter& Formatter::sWhile(const std::string& cond, const std::function<void(void)>& block) {
-    (*this) << "while (" << cond << ") ";
-    return this->block(block);
+Formatter &Formatter::endl() {
+    return (*this) << "\n";
 }
 
-Formatter &Formatter::operator<<(const std::string &out) {
-    const size_t len = out.length();
-    size_t start = 0;
-    while (start < len) {
-        size_t pos = out.find('\n', start);
+Formatter& Formatter::operator<<(std::string_view out) {
+    while (!out.empty()) {
+        size_t pos = out.find('\n');
 
-        if (pos == std::string::npos) {
+        if (pos == std::string_view::npos) {
             if (mAtStartOfLine) {
-                fprintf(mFile, "%*s", (int)(mSpacesPerIndent * mIndentDepth), "");
-                fprintf(mFile, "%s", mLinePrefix.c_str());
+                printIndent();
                 mAtStartOfLine = false;
             }
 
-            output(out.substr(start));
+            output(out);
             break;
         }
 
-        if (mAtStartOfLine && (pos > start || !mLinePrefix.empty())) {
-            fprintf(mFile, "%*s", (int)(mSpacesPerIndent * mIndentDepth), "");
-            fprintf(mFile, "%s", mLinePrefix.c_str());
+        if (mAtStartOfLine && (pos > 0 || !mLinePrefix.empty())) {
+            printIndent();
         }
 
-        if (pos == start) {
-            fprintf(mFile, "\n");
-            mAtStartOfLine = true;
-        } else if (pos > start) {
-            output(out.substr(start, pos - start + 1));
-            mAtStartOfLine = true;
-        }
+        output(out.substr(0, pos + 1));
+        mAtStartOfLine = true;
 
-        start = pos + 1;
+        out.remove_prefix(pos + 1);
     }
 
     return *this;
 }
 
 // NOLINT to suppress missing parentheses warning about __type__.
-#define FORMATTER_INPUT_INTEGER(__type__)                       \
-    Formatter& Formatter::operator<<(__type__ n) { /* NOLINT */ \
-        return (*this) << std::to_string(n);                    \
+#define FORMATTER_INPUT_INTEGER(__type__)                              \
+    Formatter& Formatter::operator<<(__type__ n) { /* NOLINT */        \
+        char buf[32];                                                  \
+        auto result = std::to_chars(buf, buf + sizeof(buf), n);        \
+        return (*this) << std::string_view(buf, result.ptr - buf);     \
     }
 
 FORMATTER_INPUT_INTEGER(short);
@@ -165,16 +221,26 @@ FORMATTER_INPUT_INTEGER(long);
 FORMATTER_INPUT_INTEGER(unsigned long);
 FORMATTER_INPUT_INTEGER(long long);
 FORMATTER_INPUT_INTEGER(unsigned long long);
-FORMATTER_INPUT_INTEGER(float);
-FORMATTER_INPUT_INTEGER(double);
-FORMATTER_INPUT_INTEGER(long double);
 
 #undef FORMATTER_INPUT_INTEGER
 
+// NOLINT to suppress missing parentheses warning about __type__.
+#define FORMATTER_INPUT_FLOAT(__type__)                         \
+    Formatter& Formatter::operator<<(__type__ n) { /* NOLINT */ \
+        return (*this) << std::to_string(n);                    \
+    }
+
+FORMATTER_INPUT_FLOAT(float);
+FORMATTER_INPUT_FLOAT(double);
+FORMATTER_INPUT_FLOAT(long double);
+
+#undef FORMATTER_INPUT_FLOAT
+
 // NOLINT to suppress missing parentheses warning about __type__.
 #define FORMATTER_INPUT_CHAR(__type__)                          \
     Formatter& Formatter::operator<<(__type__ c) { /* NOLINT */ \
-        return (*this) << std::string(1, (char)c);              \
+        const char ch = static_cast<char>(c);                   \
+        return (*this) << std::string_view(&ch, 1);             \
     }
 
 FORMATTER_INPUT_CHAR(char);
@@ -188,13 +254,30 @@ void Formatter::setNamespace(const std::string &space) {
 }
 
 bool Formatter::isValid() const {
-    return mFile != nullptr;
+    return mFile != nullptr || mTmpFile != nullptr;
+}
+
+void Formatter::printIndent() {
+    mBuffer.append(mSpacesPerIndent * mIndentDepth, ' ');
+    mBuffer.append(mLinePrefix);
 }
 
-void Formatter::output(const std::string &text) const {
+void Formatter::output(std::string_view text) {
     CHECK(isValid());
 
-    fprintf(mFile, "%s", text.c_str());
+    mBuffer.append(text);
+
+    if (mFile != nullptr && mBuffer.size() >= kFlushThreshold) {
+        flush();
+    }
+}
+
+void Formatter::flush() {
+    if (mFile != nullptr && !mBuffer.empty()) {
+        Profiler::count(Profiler::Counter::BYTES_EMITTED, mBuffer.size());
+        fwrite(mBuffer.data(), 1, mBuffer.size(), mFile);
+        mBuffer.clear();
+    }
 }
 
 }  // namespace android
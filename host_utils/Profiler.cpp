@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Profiler.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include <iterator>
+#include <mutex>
+#include <vector>
+
+#include <android-base/file.h>
+
+namespace android {
+
+std::atomic<bool> Profiler::sEnabled{false};
+std::atomic<bool> Profiler::sCountingAllocations{false};
+std::atomic<size_t> Profiler::sCounters[static_cast<size_t>(Counter::COUNT)];
+
+namespace {
+
+struct Event {
+    const char* name;
+    std::string detail;
+    size_t thread;
+    int64_t startUs;
+    int64_t durationUs;
+    int64_t cpuUs;
+    size_t allocations;
+};
+
+std::mutex gEventsMutex;
+std::vector<Event> gEvents;  // guarded by gEventsMutex
+size_t gNextThread = 0;      // guarded by gEventsMutex
+
+const char* const kCounterNames[] = {
+    "files_parsed",
+    "parse_cache_hits",
+    "bytes_emitted",
+};
+static_assert(std::size(kCounterNames) == static_cast<size_t>(Profiler::Counter::COUNT));
+
+int64_t nowUs(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+// Small thread ids, in order of the first phase each thread ended.
+size_t threadIndexLocked() {
+    static thread_local size_t index = SIZE_MAX;
+    if (index == SIZE_MAX) index = gNextThread++;
+    return index;
+}
+
+void appendJsonString(const std::string& value, std::string* out) {
+    out->push_back('"');
+    for (char c : value) {
+        switch (c) {
+            case '"':
+                out->append("\\\"");
+                break;
+            case '\\':
+                out->append("\\\\");
+                break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char escaped[7];
+                    snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    out->append(escaped);
+                } else {
+                    out->push_back(c);
+                }
+        }
+    }
+    out->push_back('"');
+}
+
+}  // namespace
+
+void Profiler::setEnabled(bool enabled) {
+    sEnabled = enabled;
+}
+
+void Profiler::setCountingAllocations(bool counting) {
+    sCountingAllocations = counting;
+}
+
+Profiler::Phase::Phase(const char* name, std::string detail) : mName(nullptr) {
+    if (!isEnabled()) return;
+
+    mName = name;
+    mDetail = std::move(detail);
+    mStartUs = nowUs(CLOCK_MONOTONIC);
+    mStartCpuUs = nowUs(CLOCK_THREAD_CPUTIME_ID);
+    mStartAllocations = sAllocations;
+}
+
+Profiler::Phase::~Phase() {
+    if (mName == nullptr) return;
+
+    Event event{mName,
+                std::move(mDetail),
+                0 /* thread */,
+                mStartUs,
+                nowUs(CLOCK_MONOTONIC) - mStartUs,
+                nowUs(CLOCK_THREAD_CPUTIME_ID) - mStartCpuUs,
+                sAllocations - mStartAllocations};
+
+    std::lock_guard<std::mutex> lock(gEventsMutex);
+    event.thread = threadIndexLocked();
+    gEvents.push_back(std::move(event));
+}
+
+bool Profiler::writeTrace(const std::string& path) {
+    const int pid = getpid();
+    const int64_t endUs = nowUs(CLOCK_MONOTONIC);
+
+    std::string out = "{\"traceEvents\":[\n";
+    {
+        std::lock_guard<std::mutex> lock(gEventsMutex);
+        for (const Event& event : gEvents) {
+            out += "{\"name\":\"";
+            out += event.name;
+            out += "\",\"cat\":\"hidl-gen\",\"ph\":\"X\",\"pid\":" + std::to_string(pid) +
+                   ",\"tid\":" + std::to_string(event.thread) +
+                   ",\"ts\":" + std::to_string(event.startUs) +
+                   ",\"dur\":" + std::to_string(event.durationUs) + ",\"args\":{\"detail\":";
+            appendJsonString(event.detail, &out);
+            out += ",\"cpu_us\":" + std::to_string(event.cpuUs);
+            if (sCountingAllocations) {
+                out += ",\"allocations\":" + std::to_string(event.allocations);
+            }
+            out += "}},\n";
+        }
+    }
+
+    out += "{\"name\":\"counters\",\"cat\":\"hidl-gen\",\"ph\":\"C\",\"pid\":" +
+           std::to_string(pid) + ",\"tid\":0,\"ts\":" + std::to_string(endUs) + ",\"args\":{";
+    for (size_t i = 0; i < static_cast<size_t>(Counter::COUNT); i++) {
+        if (i != 0) out += ",";
+        out += "\"" + std::string(kCounterNames[i]) + "\":" + std::to_string(sCounters[i].load());
+    }
+    out += "}}\n]}\n";
+
+    if (!base::WriteStringToFile(out, path)) {
+        fprintf(stderr, "ERROR: could not write trace %s: %d\n", path.c_str(), errno);
+        return false;
+    }
+    return true;
+}
+
+}  // namespace android
@@ -18,8 +18,12 @@
 
 #define FORMATTER_H_
 
-#include <functional>
+#include <stdio.h>
+#include <iterator>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
 
 namespace android {
 
@@ -33,9 +37,22 @@ struct Formatter {
 
     // Assumes ownership of file. Directed to stdout if file == NULL.
     Formatter(FILE* file, size_t spacesPerIndent = 4);
-    Formatter(Formatter&&) = default;
+
+    // Output is kept in memory and written to path by commit(), unless path
+    // already has exactly these contents. This keeps the modification time of
+    // files which are generated again unchanged. The file is replaced
+    // atomically through a temporary file next to it, which is created here;
+    // the Formatter is invalid if that fails. Output which is not committed
+    // is discarded.
+    Formatter(const std::string& path, size_t spacesPerIndent = 4);
+
+    Formatter(Formatter&& other);
     ~Formatter();
 
+    // Writes out the output, and returns whether that succeeded. Nothing may
+    // be output afterwards.
+    bool commit();
+
     void indent(size_t level = 1);
     void unindent(size_t level = 1);
 
@@ -43,13 +60,15 @@ struct Formatter {
     // out.indent(2, [&] {
     //     out << "Meow\n";
     // });
-    Formatter& indent(size_t level, const std::function<void(void)>& func);
+    template <typename F>
+    Formatter& indent(size_t level, F&& func);
 
     // Note that The last \n after the last line is NOT added automatically.
     // out.indent([&] {
     //     out << "Meow\n";
     // });
-    Formatter& indent(const std::function<void(void)>& func);
+    template <typename F, typename = std::enable_if_t<std::is_invocable_v<F&>>>
+    Formatter& indent(F&& func);
 
     // A block inside braces.
     // * No space will be added before the opening brace.
@@ -63,7 +82,8 @@ struct Formatter {
     // out << "{\n"
     //     << "one();\ntwo();\n" // func()
     //     << "}";
-    Formatter& block(const std::function<void(void)>& func);
+    template <typename F>
+    Formatter& block(F&& func);
 
     // A synonym to (*this) << "\n";
     Formatter &endl();
@@ -76,14 +96,18 @@ struct Formatter {
     //     out << "logFatal();\n";
     // }).endl();
     // note that there will be a space before the "else"-s.
-    Formatter& sIf(const std::string& cond, const std::function<void(void)>& block);
-    Formatter& sElseIf(const std::string& cond, const std::function<void(void)>& block);
-    Formatter& sElse(const std::function<void(void)>& block);
+    template <typename F>
+    Formatter& sIf(std::string_view cond, F&& block);
+    template <typename F>
+    Formatter& sElseIf(std::string_view cond, F&& block);
+    template <typename F>
+    Formatter& sElse(F&& block);
 
     // out.sFor("int i = 0; i < 10; i++", [&] {
     //     out << "printf(\"%d\", i);\n";
     // }).endl();
-    Formatter& sFor(const std::string& stmts, const std::function<void(void)>& block);
+    template <typename F>
+    Formatter& sFor(std::string_view stmts, F&& block);
 
     // out.sTry([&] {
     //     out << "throw RemoteException();\n"
@@ -93,24 +117,26 @@ struct Formatter {
     //     // cleanup
     // }).endl();
     // note that there will be a space before the "catch"-s.
-    Formatter& sTry(const std::function<void(void)>& block);
-    Formatter& sCatch(const std::string& exception, const std::function<void(void)>& block);
-    Formatter& sFinally(const std::function<void(void)>& block);
+    template <typename F>
+    Formatter& sTry(F&& block);
+    template <typename F>
+    Formatter& sCatch(std::string_view exception, F&& block);
+    template <typename F>
+    Formatter& sFinally(F&& block);
 
     // out.sWhile("z < 10", [&] {
     //     out << "z++;\n";
     // }).endl();
-    Formatter& sWhile(const std::string& cond, const std::function<void(void)>& block);
+    template <typename F>
+    Formatter& sWhile(std::string_view cond, F&& block);
 
     // out.join(v.begin(), v.end(), ",", [&](const auto &e) {
     //     out << toString(e);
     // });
-    template <typename I>
-    Formatter& join(
-        const I begin, const I end, const std::string& separator,
-        const std::function<void(const typename std::iterator_traits<I>::value_type&)>& func);
+    template <typename I, typename F>
+    Formatter& join(const I begin, const I end, std::string_view separator, F&& func);
 
-    Formatter &operator<<(const std::string &out);
+    Formatter &operator<<(std::string_view out);
 
     Formatter &operator<<(char c);
     Formatter &operator<<(signed char c);
@@ -145,7 +171,13 @@ struct Formatter {
     // Creates an invalid formatter object.
     Formatter();
 
-    FILE* mFile;  // invalid if nullptr
+    FILE* mFile;  // invalid if nullptr and mTmpFile is nullptr
+    std::string mPath;  // if not empty, output is only written by commit()
+    FILE* mTmpFile;     // written and renamed to mPath by commit()
+    std::string mTmpPath;
+    // Output not yet written to mFile or mPath. For files it is flushed once
+    // it grows beyond kFlushThreshold.
+    std::string mBuffer;
     size_t mIndentDepth;
     size_t mSpacesPerIndent;
     bool mAtStartOfLine;
@@ -153,16 +185,86 @@ struct Formatter {
     std::string mSpace;
     std::string mLinePrefix;
 
-    void output(const std::string &text) const;
+    void printIndent();
+    void output(std::string_view text);
+    void flush();
+    bool writeIfChanged();
+    void discard();
 
     Formatter(const Formatter&) = delete;
     void operator=(const Formatter&) = delete;
 };
 
-template <typename I>
-Formatter& Formatter::join(
-    const I begin, const I end, const std::string& separator,
-    const std::function<void(const typename std::iterator_traits<I>::value_type&)>& func) {
+template <typename F>
+Formatter& Formatter::indent(size_t level, F&& func) {
+    this->indent(level);
+    func();
+    this->unindent(level);
+    return *this;
+}
+
+template <typename F, typename>
+Formatter& Formatter::indent(F&& func) {
+    return this->indent(1, std::forward<F>(func));
+}
+
+template <typename F>
+Formatter& Formatter::block(F&& func) {
+    (*this) << "{\n";
+    this->indent(std::forward<F>(func));
+    return (*this) << "}";
+}
+
+template <typename F>
+Formatter& Formatter::sIf(std::string_view cond, F&& block) {
+    (*this) << "if (" << cond << ") ";
+    return this->block(std::forward<F>(block));
+}
+
+template <typename F>
+Formatter& Formatter::sElseIf(std::string_view cond, F&& block) {
+    (*this) << " else if (" << cond << ") ";
+    return this->block(std::forward<F>(block));
+}
+
+template <typename F>
+Formatter& Formatter::sElse(F&& block) {
+    (*this) << " else ";
+    return this->block(std::forward<F>(block));
+}
+
+template <typename F>
+Formatter& Formatter::sFor(std::string_view stmts, F&& block) {
+    (*this) << "for (" << stmts << ") ";
+    return this->block(std::forward<F>(block));
+}
+
+template <typename F>
+Formatter& Formatter::sTry(F&& block) {
+    (*this) << "try ";
+    return this->block(std::forward<F>(block));
+}
+
+template <typename F>
+Formatter& Formatter::sCatch(std::string_view exception, F&& block) {
+    (*this) << " catch (" << exception << ") ";
+    return this->block(std::forward<F>(block));
+}
+
+template <typename F>
+Formatter& Formatter::sFinally(F&& block) {
+    (*this) << " finally ";
+    return this->block(std::forward<F>(block));
+}
+
+template <typename F>
+Formatter& Formatter::sWhile(std::string_view cond, F&& block) {
+    (*this) << "while (" << cond << ") ";
+    return this->block(std::forward<F>(block));
+}
+
+template <typename I, typename F>
+Formatter& Formatter::join(const I begin, const I end, std::string_view separator, F&& func) {
     for (I iter = begin; iter != end; ++iter) {
         if (iter != begin) {
             (*this) << separator;
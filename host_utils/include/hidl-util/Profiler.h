@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PROFILER_H_
+
+#define PROFILER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <string>
+
+namespace android {
+
+// Records how long phases of hidl-gen take, in wall and CPU time, and how
+// many allocations each of them makes, along with counters of events. Nothing
+// is recorded unless it is enabled, see hidl-gen -t. Disabled phases and
+// counters still load a flag, and a disabled phase constructs its detail
+// string. Allocations are only counted in builds which call onAllocation,
+// see HIDL_GEN_COUNT_ALLOCATIONS in main.cpp.
+struct Profiler {
+    enum class Counter {
+        FILES_PARSED,
+        PARSE_CACHE_HITS,
+        BYTES_EMITTED,
+        COUNT,  // number of counters
+    };
+
+    static void setEnabled(bool enabled);
+    static bool isEnabled() { return sEnabled.load(std::memory_order_relaxed); }
+
+    static void count(Counter counter, size_t value = 1) {
+        if (!isEnabled()) return;
+        sCounters[static_cast<size_t>(counter)].fetch_add(value, std::memory_order_relaxed);
+    }
+
+    // Must be called for every allocation for phases to report them, see
+    // operator new in main.cpp. Allocations are counted per thread.
+    static void onAllocation() { sAllocations++; }
+
+    // Whether onAllocation is called for every allocation. If not, phases
+    // do not report allocations.
+    static void setCountingAllocations(bool counting);
+
+    // Records the time from construction to destruction as a phase, e.x.
+    //     Profiler::Phase phase("parse", fqName.string());
+    // Phases may nest, but must end on the thread they started on.
+    struct Phase {
+        explicit Phase(const char* name, std::string detail = "");
+        ~Phase();
+
+       private:
+        const char* mName;  // nullptr if not recorded
+        std::string mDetail;
+        int64_t mStartUs;
+        int64_t mStartCpuUs;
+        size_t mStartAllocations;
+
+        Phase(const Phase&) = delete;
+        void operator=(const Phase&) = delete;
+    };
+
+    // Writes all phases recorded so far and the counters to path, in the
+    // Chrome trace event format (JSON), which chrome://tracing and Perfetto
+    // can display.
+    static bool writeTrace(const std::string& path);
+
+   private:
+    static std::atomic<bool> sEnabled;
+    static std::atomic<bool> sCountingAllocations;
+    static std::atomic<size_t> sCounters[static_cast<size_t>(Counter::COUNT)];
+    static inline thread_local size_t sAllocations = 0;
+};
+
+}  // namespace android
+
+#endif  // PROFILER_H_
@@ -20,16 +20,27 @@
 #include "Scope.h"
 
 #include <android-base/logging.h>
+#include <android-base/parseint.h>
 #include <hidl-hash/Hash.h>
 #include <hidl-util/FQName.h>
 #include <hidl-util/Formatter.h>
+#include <hidl-util/Profiler.h>
 #include <hidl-util/StringHelper.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <fstream>
 #include <iostream>
+#include <iterator>
 #include <set>
+#include <sstream>
 #include <string>
+#include <thread>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
 using namespace android;
@@ -99,12 +110,16 @@ struct FileGenerator {
             return OK;
         }
 
+        Profiler::Phase phase("generate", fqName.string() + " " + getFileName(fqName));
         Formatter out = coordinator->getFormatter(fqName, location, getFileName(fqName));
         if (!out.isValid()) {
             return UNKNOWN_ERROR;
         }
 
-        return mGenerationFunction(out, fqName, coordinator);
+        status_t err = mGenerationFunction(out, fqName, coordinator);
+        if (err != OK) return err;
+
+        return out.commit() ? OK : UNKNOWN_ERROR;
     }
 
     // Helper methods for filling out this struct
@@ -139,12 +154,12 @@ struct OutputHandler {
     }
 
     status_t writeDepFile(const FQName& fqName, const Coordinator* coordinator) const;
+    status_t appendOutputFiles(const FQName& fqName, const Coordinator* coordinator,
+                               std::vector<std::string>* outputFiles) const;
 
    private:
     status_t appendTargets(const FQName& fqName, const Coordinator* coordinator,
                            std::vector<FQName>* targets) const;
-    status_t appendOutputFiles(const FQName& fqName, const Coordinator* coordinator,
-                               std::vector<std::string>* outputFiles) const;
 };
 
 // Helper method for GenerationGranularity::PER_TYPE
@@ -208,19 +223,89 @@ status_t OutputHandler::appendTargets(const FQName& fqName, const Coordinator* c
     return OK;
 }
 
+// Lookups parse interfaces imported with their whole package on demand, see
+// AST::getPendingImports, which modifies the ASTs which import them. This
+// parses all of them for the package of fqName and the packages it imports.
+static status_t resolvePendingImports(const FQName& fqName, const Coordinator* coordinator) {
+    std::vector<FQName> packageInterfaces;
+    status_t err = coordinator->appendPackageInterfacesToVector(fqName.getPackageAndVersion(),
+                                                               &packageInterfaces);
+    if (err != OK) return err;
+
+    for (const FQName& packageInterface : packageInterfaces) {
+        AST* ast = coordinator->parse(packageInterface);
+        if (ast == nullptr) {
+            fprintf(stderr, "ERROR: Could not parse %s. Aborting.\n",
+                    packageInterface.string().c_str());
+            return UNKNOWN_ERROR;
+        }
+
+        std::set<FQName> importedPackages;
+        err = ast->getImportedPackagesHierarchy(&importedPackages);
+        if (err != OK) return err;
+    }
+
+    return OK;
+}
+
 status_t OutputHandler::generate(const FQName& fqName, const Coordinator* coordinator) const {
     std::vector<FQName> targets;
     status_t err = appendTargets(fqName, coordinator, &targets);
     if (err != OK) return err;
 
+    // Output to stdout has to stay in order.
+    if (coordinator->getJobs() == 1 || mLocation == Coordinator::Location::STANDARD_OUT) {
+        for (const FQName& fqName : targets) {
+            for (const FileGenerator& file : mGenerateFunctions) {
+                status_t err = file.generate(fqName, coordinator, mLocation);
+                if (err != OK) return err;
+            }
+        }
+        return OK;
+    }
+
+    // Restrictions are otherwise enforced by the first thread to parse a file
+    // of the package, and finding unfrozen files changes hashes which are part
+    // of the output of the others.
+    err = coordinator->enforceRestrictionsOnPackage(fqName);
+    if (err != OK) return err;
+
+    err = resolvePendingImports(fqName, coordinator);
+    if (err != OK) return err;
+
+    // ASTs are not modified once they are parsed and their pending imports
+    // are resolved, so each file can be generated on a different thread.
+    std::vector<std::pair<const FQName*, const FileGenerator*>> files;
     for (const FQName& fqName : targets) {
         for (const FileGenerator& file : mGenerateFunctions) {
-            status_t err = file.generate(fqName, coordinator, mLocation);
-            if (err != OK) return err;
+            files.emplace_back(&fqName, &file);
         }
     }
 
-    return OK;
+    std::atomic<size_t> next(0);
+    std::atomic<status_t> result(OK);
+
+    auto worker = [&] {
+        for (size_t i = next++; i < files.size() && result == OK; i = next++) {
+            status_t err = files[i].second->generate(*files[i].first, coordinator, mLocation);
+            if (err != OK) {
+                status_t expected = OK;
+                result.compare_exchange_strong(expected, err);
+            }
+        }
+    };
+
+    // This thread is one of the workers.
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < std::min(coordinator->getJobs(), files.size()); i++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    return result;
 }
 
 status_t OutputHandler::appendOutputFiles(const FQName& fqName, const Coordinator* coordinator,
@@ -348,7 +433,7 @@ static status_t isPackageJavaCompatible(const FQName& packageFQName, const Coord
         return err;
     }
 
-    std::set<FQName> seen;
+    std::unordered_set<FQName> seen;
     for (const auto &iface : todo) {
         seen.insert(iface);
     }
@@ -561,7 +646,8 @@ static status_t generateAndroidBpForPackage(Formatter& out, const FQName& packag
             typesAST = ast;
         }
 
-        ast->getImportedPackagesHierarchy(&importedPackagesHierarchy);
+        err = ast->getImportedPackagesHierarchy(&importedPackagesHierarchy);
+        if (err != OK) return err;
         ast->appendToExportedTypesVector(&exportedTypes);
     }
 
@@ -865,7 +951,7 @@ static status_t generateHashOutput(Formatter& out, const FQName& fqName,
         return UNKNOWN_ERROR;
     }
 
-    out << Hash::getHash(ast->getFilename()).hexString() << " " << fqName.string() << "\n";
+    out << Hash::hexString(ast->getOutputHash()) << " " << fqName.string() << "\n";
 
     return OK;
 }
@@ -945,6 +1031,14 @@ static const std::vector<FileGenerator> kCppSourceFormats = {
     },
 };
 
+static const std::vector<FileGenerator> kCppDescriptorsFormats = {
+    {
+        FileGenerator::alwaysGenerate,
+        [](const FQName& fqName) { return fqName.name() + "Descriptors.h"; },
+        astGenerationFunction(&AST::generateCppDescriptorsHeader),
+    },
+};
+
 static const std::vector<FileGenerator> kCppImplHeaderFormats = {
     {
         FileGenerator::generateForInterfaces,
@@ -1024,6 +1118,16 @@ static const std::vector<OutputHandler> kFormats = {
         validateForSource,
         kCppSourceFormats,
     },
+    {
+        "c++-descriptors",
+        "(internal) Generates C++ headers with the layouts of types and methods as constexpr "
+        "tables.",
+        OutputMode::NEEDS_DIR,
+        Coordinator::Location::GEN_OUTPUT,
+        GenerationGranularity::PER_FILE,
+        validateForSource,
+        kCppDescriptorsFormats,
+    },
     {
         "export-header",
         "Generates a header file from @export enumerations to help maintain legacy code.",
@@ -1217,10 +1321,221 @@ static const std::vector<OutputHandler> kFormats = {
 };
 // clang-format on
 
+static const OutputHandler* findOutputHandler(const std::string& name) {
+    for (auto& e : kFormats) {
+        if (e.name() == name) {
+            return &e;
+        }
+    }
+    return nullptr;
+}
+
+// Computes the output path expected by outputFormat and sets it on the coordinator.
+// Returns BAD_VALUE if outputFormat needs an output path but none was given.
+static status_t setOutputPathForFormat(const OutputHandler* outputFormat, std::string outputPath,
+                                       Coordinator* coordinator) {
+    switch (outputFormat->mOutputMode) {
+        case OutputMode::NEEDS_DIR:
+        case OutputMode::NEEDS_FILE: {
+            if (outputPath.empty()) {
+                return BAD_VALUE;
+            }
+
+            if (outputFormat->mOutputMode == OutputMode::NEEDS_DIR) {
+                if (outputPath.back() != '/') {
+                    outputPath += "/";
+                }
+            }
+            break;
+        }
+        case OutputMode::NEEDS_SRC: {
+            if (outputPath.empty()) {
+                outputPath = coordinator->getRootPath();
+            }
+            if (outputPath.back() != '/') {
+                outputPath += "/";
+            }
+
+            break;
+        }
+
+        default:
+            outputPath.clear();  // Unused.
+            break;
+    }
+
+    coordinator->setOutputPath(outputPath);
+    return OK;
+}
+
+static status_t generateForFqNames(const OutputHandler* outputFormat,
+                                   const std::vector<std::string>& fqNames,
+                                   const Coordinator* coordinator) {
+    for (const std::string& arg : fqNames) {
+        FQName fqName;
+        if (!FQName::parse(arg, &fqName)) {
+            fprintf(stderr, "ERROR: Invalid fully-qualified name as argument: %s.\n", arg.c_str());
+            return BAD_VALUE;
+        }
+
+        // Nothing is parsed if the files generated last time are up to date.
+        std::string outputsKey;
+        if (outputFormat->mLocation != Coordinator::Location::STANDARD_OUT) {
+            outputsKey = coordinator->getOutputsKey(outputFormat->name() + " " + fqName.string());
+        }
+        if (coordinator->areOutputsUpToDate(outputsKey)) {
+            status_t err = outputFormat->writeDepFile(fqName, coordinator);
+            if (err != OK) return err;
+            continue;
+        }
+
+        if (!outputsKey.empty()) coordinator->startRecordingInputs();
+
+        if (coordinator->getPackageInterfaceFiles(fqName, nullptr /*fileNames*/) != OK) {
+            fprintf(stderr, "ERROR: Could not get sources for %s.\n", arg.c_str());
+            return UNKNOWN_ERROR;
+        }
+
+        // All files of the package are parsed anyway to enforce restrictions on it.
+        // Failures are cached and reported once the files are used below.
+        if (coordinator->getJobs() > 1) {
+            std::vector<FQName> packageInterfaces;
+            status_t err = coordinator->appendPackageInterfacesToVector(
+                fqName.getPackageAndVersion(), &packageInterfaces);
+            if (err != OK) return err;
+
+            coordinator->parseInParallel(packageInterfaces, Coordinator::Enforce::NONE);
+        }
+
+        // Dump extra verbose output
+        if (coordinator->isVerbose()) {
+            status_t err =
+                dumpDefinedButUnreferencedTypeNames(fqName.getPackageAndVersion(), coordinator);
+            if (err != OK) return err;
+        }
+
+        if (!outputFormat->validate(fqName, coordinator, outputFormat->name())) {
+            fprintf(stderr,
+                    "ERROR: output handler failed.\n");
+            return UNKNOWN_ERROR;
+        }
+
+        status_t err = outputFormat->generate(fqName, coordinator);
+        if (err != OK) return err;
+
+        err = outputFormat->writeDepFile(fqName, coordinator);
+        if (err != OK) return err;
+
+        if (!outputsKey.empty()) {
+            std::vector<std::string> outputFiles;
+            err = outputFormat->appendOutputFiles(fqName, coordinator, &outputFiles);
+            if (err != OK) return err;
+            coordinator->recordOutputs(outputsKey, fqName, outputFiles);
+        }
+    }
+
+    return OK;
+}
+
+// Each non-empty line of a batch file which is not a comment (#) has the form
+//     <language> <output path> FQNAME...
+// where <output path> is "-" for languages which do not create files.
+static status_t generateForBatchLine(const std::string& line, const std::string& where,
+                                     Coordinator* coordinator) {
+    coordinator->beginRun();
+
+    std::istringstream lineStream(line.substr(0, line.find('#')));
+    std::vector<std::string> words{std::istream_iterator<std::string>(lineStream),
+                                   std::istream_iterator<std::string>()};
+    if (words.empty()) return OK;
+
+    if (words.size() < 3) {
+        fprintf(stderr, "ERROR: %s: expecting <language> <output path> FQNAME...\n",
+                where.c_str());
+        return BAD_VALUE;
+    }
+
+    const OutputHandler* outputFormat = findOutputHandler(words[0]);
+    if (outputFormat == nullptr) {
+        fprintf(stderr, "ERROR: %s: unrecognized language: \"%s\".\n", where.c_str(),
+                words[0].c_str());
+        return BAD_VALUE;
+    }
+
+    std::string outputPath = words[1] == "-" ? "" : words[1];
+    if (setOutputPathForFormat(outputFormat, outputPath, coordinator) != OK) {
+        fprintf(stderr, "ERROR: %s: language \"%s\" requires an output path.\n", where.c_str(),
+                words[0].c_str());
+        return BAD_VALUE;
+    }
+
+    return generateForFqNames(outputFormat, {words.begin() + 2, words.end()}, coordinator);
+}
+
+// All lines are processed by the same Coordinator, so every .hal file and
+// current.txt is only read, parsed and hashed once for the entire batch.
+static status_t generateForBatchFile(const std::string& batchFile, Coordinator* coordinator) {
+    std::ifstream stream(batchFile);
+    if (!stream) {
+        fprintf(stderr, "ERROR: could not open batch file %s.\n", batchFile.c_str());
+        return UNKNOWN_ERROR;
+    }
+    coordinator->onFileAccess(batchFile, "r");
+
+    std::string line;
+    size_t lineNumber = 0;
+    while (std::getline(stream, line)) {
+        lineNumber++;
+
+        status_t err = generateForBatchLine(line, batchFile + ":" + std::to_string(lineNumber),
+                                            coordinator);
+        if (err != OK) return err;
+    }
+
+    return OK;
+}
+
+// Reads batch lines from stdin until it is closed. Parsed files are kept
+// between lines, only those which changed on disk (or import something
+// which did) are parsed again. Once a line is processed, "hidl-gen: done 0"
+// (or a non-zero status on failure) is printed on a line of its own to stdout.
+static void serve(Coordinator* coordinator) {
+    std::string line;
+    size_t lineNumber = 0;
+    while (std::getline(std::cin, line)) {
+        lineNumber++;
+
+        size_t invalidated = coordinator->invalidateChangedFiles();
+        if (coordinator->isVerbose()) {
+            fprintf(stderr, "VERBOSE: %zu parsed files are out of date\n", invalidated);
+        }
+
+        status_t err =
+            generateForBatchLine(line, "stdin:" + std::to_string(lineNumber), coordinator);
+        coordinator->printStatistics();
+
+        fflush(stderr);
+        fprintf(stdout, "hidl-gen: done %d\n", err == OK ? 0 : 1);
+        fflush(stdout);
+    }
+}
+
+// Writes phases recorded so far if -t was given. A trace which cannot be
+// written does not fail generation.
+static void writeTrace(const std::string& traceFile) {
+    if (traceFile.empty()) return;
+    Profiler::writeTrace(traceFile);
+}
+
 static void usage(const char *me) {
     fprintf(stderr,
             "usage: %s [-p <root path>] -o <output path> -L <language> [-O <owner>] (-r <interface "
-            "root>)+ [-R] [-v] [-d <depfile>] FQNAME...\n\n",
+            "root>)+ [-R] [-v] [-j <jobs>] [-c <cache dir>] [-t <trace file>] [-d <depfile>] "
+            "FQNAME...\n",
+            me);
+    fprintf(stderr,
+            "       %s [-p <root path>] [-O <owner>] (-r <interface root>)+ [-R] [-v] [-j <jobs>] "
+            "[-c <cache dir>] [-t <trace file>] (-B <batch file> | -S)\n\n",
             me);
 
     fprintf(stderr,
@@ -1237,9 +1552,41 @@ static void usage(const char *me) {
     fprintf(stderr, "         -R: Do not add default package roots if not specified in -r.\n");
     fprintf(stderr, "         -r <package:path root>: E.g., android.hardware:hardware/interfaces.\n");
     fprintf(stderr, "         -v: verbose output.\n");
+    fprintf(stderr, "         -j <jobs>: Number of threads used to parse .hal files and to\n");
+    fprintf(stderr, "                    generate output files.\n");
     fprintf(stderr, "         -d <depfile>: location of depfile to write to.\n");
+    fprintf(stderr, "         -c <cache dir>: Reuse results of previous invocations stored here.\n");
+    fprintf(stderr, "         -t <trace file>: Write time spent in each phase and counters to\n");
+    fprintf(stderr, "                          this file as a Chrome trace (JSON).\n");
+    fprintf(stderr, "         -B <batch file>: Run every '<language> <output path> FQNAME...'\n");
+    fprintf(stderr, "                          line of the file in this process. Use '-' as\n");
+    fprintf(stderr, "                          output path for languages that do not need one.\n");
+    fprintf(stderr, "         -S: Keep running, reading batch file lines from stdin. Files are\n");
+    fprintf(stderr, "             only parsed again once they change. Prints 'hidl-gen: done\n");
+    fprintf(stderr, "             <status>' to stdout after each line.\n");
 }
 
+#ifdef HIDL_GEN_COUNT_ALLOCATIONS
+// Counts allocations for phases recorded with -t. The other forms of operator
+// new and delete use these. This costs a thread local increment for every
+// allocation, with or without -t, and hides mismatched new and delete from
+// AddressSanitizer, so it is only built when profiling hidl-gen itself, e.g.
+// with cflags: ["-DHIDL_GEN_COUNT_ALLOCATIONS"].
+void* operator new(size_t size) {
+    Profiler::onAllocation();
+    void* ptr = malloc(size == 0 ? 1 : size);
+    if (ptr == nullptr) {
+        fprintf(stderr, "ERROR: out of memory.\n");
+        abort();
+    }
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+    free(ptr);
+}
+#endif  // HIDL_GEN_COUNT_ALLOCATIONS
+
 // hidl is intentionally leaky. Turn off LeakSanitizer by default.
 extern "C" const char *__asan_default_options() {
     return "detect_leaks=0";
@@ -1255,10 +1602,13 @@ int main(int argc, char **argv) {
     const OutputHandler* outputFormat = nullptr;
     Coordinator coordinator;
     std::string outputPath;
+    std::string batchFile;
+    std::string traceFile;
+    bool serveStdin = false;
     bool suppressDefaultPackagePaths = false;
 
     int res;
-    while ((res = getopt(argc, argv, "hp:o:O:r:L:vd:R")) >= 0) {
+    while ((res = getopt(argc, argv, "hp:o:O:r:L:vd:RB:Sj:c:t:")) >= 0) {
         switch (res) {
             case 'p': {
                 if (!coordinator.getRootPath().empty()) {
@@ -1330,12 +1680,7 @@ int main(int argc, char **argv) {
                             outputFormat->name().c_str());
                     exit(1);
                 }
-                for (auto& e : kFormats) {
-                    if (e.name() == optarg) {
-                        outputFormat = &e;
-                        break;
-                    }
-                }
+                outputFormat = findOutputHandler(optarg);
                 if (outputFormat == nullptr) {
                     fprintf(stderr,
                             "ERROR: unrecognized -L option: \"%s\".\n",
@@ -1345,6 +1690,44 @@ int main(int argc, char **argv) {
                 break;
             }
 
+            case 'j': {
+                size_t jobs;
+                if (!android::base::ParseUint(optarg, &jobs) || jobs == 0) {
+                    fprintf(stderr, "ERROR: -j <jobs> must be a positive number: %s\n", optarg);
+                    exit(1);
+                }
+                coordinator.setJobs(jobs);
+                break;
+            }
+
+            case 'c': {
+                coordinator.setCacheDir(optarg);
+                break;
+            }
+
+            case 't': {
+                traceFile = optarg;
+                Profiler::setEnabled(true);
+#ifdef HIDL_GEN_COUNT_ALLOCATIONS
+                Profiler::setCountingAllocations(true);
+#endif
+                break;
+            }
+
+            case 'S': {
+                serveStdin = true;
+                break;
+            }
+
+            case 'B': {
+                if (!batchFile.empty()) {
+                    fprintf(stderr, "ERROR: -B <batch file> can only be specified once.\n");
+                    exit(1);
+                }
+                batchFile = optarg;
+                break;
+            }
+
             case '?':
             case 'h':
             default: {
@@ -1362,56 +1745,9 @@ int main(int argc, char **argv) {
         }
     }
 
-    if (outputFormat == nullptr) {
-        fprintf(stderr,
-            "ERROR: no -L option provided.\n");
-        exit(1);
-    }
-
     argc -= optind;
     argv += optind;
 
-    if (argc == 0) {
-        fprintf(stderr, "ERROR: no fqname specified.\n");
-        usage(me);
-        exit(1);
-    }
-
-    // Valid options are now in argv[0] .. argv[argc - 1].
-
-    switch (outputFormat->mOutputMode) {
-        case OutputMode::NEEDS_DIR:
-        case OutputMode::NEEDS_FILE: {
-            if (outputPath.empty()) {
-                usage(me);
-                exit(1);
-            }
-
-            if (outputFormat->mOutputMode == OutputMode::NEEDS_DIR) {
-                if (outputPath.back() != '/') {
-                    outputPath += "/";
-                }
-            }
-            break;
-        }
-        case OutputMode::NEEDS_SRC: {
-            if (outputPath.empty()) {
-                outputPath = coordinator.getRootPath();
-            }
-            if (outputPath.back() != '/') {
-                outputPath += "/";
-            }
-
-            break;
-        }
-
-        default:
-            outputPath.clear();  // Unused.
-            break;
-    }
-
-    coordinator.setOutputPath(outputPath);
-
     if (!suppressDefaultPackagePaths) {
         coordinator.addDefaultPackagePath("android.hardware", "hardware/interfaces");
         coordinator.addDefaultPackagePath("android.hidl", "system/libhidl/transport");
@@ -1419,39 +1755,57 @@ int main(int argc, char **argv) {
         coordinator.addDefaultPackagePath("android.system", "system/hardware/interfaces");
     }
 
-    for (int i = 0; i < argc; ++i) {
-        const char* arg = argv[i];
-
-        FQName fqName;
-        if (!FQName::parse(arg, &fqName)) {
-            fprintf(stderr, "ERROR: Invalid fully-qualified name as argument: %s.\n", arg);
+    if (!batchFile.empty() || serveStdin) {
+        if (!batchFile.empty() && serveStdin) {
+            fprintf(stderr, "ERROR: -B <batch file> cannot be combined with -S.\n");
             exit(1);
         }
-
-        if (coordinator.getPackageInterfaceFiles(fqName, nullptr /*fileNames*/) != OK) {
-            fprintf(stderr, "ERROR: Could not get sources for %s.\n", arg);
+        if (outputFormat != nullptr || !outputPath.empty() || argc != 0) {
+            fprintf(stderr, "ERROR: -B and -S cannot be combined with -L, -o or FQNAME.\n");
             exit(1);
         }
-
-        // Dump extra verbose output
-        if (coordinator.isVerbose()) {
-            status_t err =
-                dumpDefinedButUnreferencedTypeNames(fqName.getPackageAndVersion(), &coordinator);
-            if (err != OK) return err;
+        // The dep file would only describe the last line of the batch.
+        if (coordinator.hasDepFile()) {
+            fprintf(stderr, "ERROR: -B and -S cannot be combined with -d.\n");
+            exit(1);
         }
 
-        if (!outputFormat->validate(fqName, &coordinator, outputFormat->name())) {
-            fprintf(stderr,
-                    "ERROR: output handler failed.\n");
-            exit(1);
+        if (serveStdin) {
+            serve(&coordinator);
+            writeTrace(traceFile);
+            return 0;
         }
 
-        status_t err = outputFormat->generate(fqName, &coordinator);
+        status_t err = generateForBatchFile(batchFile, &coordinator);
+        coordinator.printStatistics();
+        writeTrace(traceFile);
         if (err != OK) exit(1);
+        return 0;
+    }
 
-        err = outputFormat->writeDepFile(fqName, &coordinator);
-        if (err != OK) exit(1);
+    if (outputFormat == nullptr) {
+        fprintf(stderr,
+            "ERROR: no -L option provided.\n");
+        exit(1);
+    }
+
+    if (argc == 0) {
+        fprintf(stderr, "ERROR: no fqname specified.\n");
+        usage(me);
+        exit(1);
+    }
+
+    // Valid options are now in argv[0] .. argv[argc - 1].
+
+    if (setOutputPathForFormat(outputFormat, outputPath, &coordinator) != OK) {
+        usage(me);
+        exit(1);
     }
 
+    status_t err = generateForFqNames(outputFormat, {argv, argv + argc}, &coordinator);
+    coordinator.printStatistics();
+    writeTrace(traceFile);
+    if (err != OK) exit(1);
+
     return 0;
 }
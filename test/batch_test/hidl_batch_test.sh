@@ -0,0 +1,112 @@
+#!/bin/bash
+
+if [ $# -gt 1 ]; then
+    echo "usage: hidl_batch_test.sh hidl-gen_path"
+    exit 1
+fi
+
+readonly HIDL_GEN_PATH=${1:-hidl-gen}
+readonly HIDL_BATCH_TEST_DIR="${ANDROID_BUILD_TOP:-.}/system/tools/hidl/test/batch_test"
+readonly HIDL_TRANSPORT_DIR="${ANDROID_BUILD_TOP:-.}/system/libhidl/transport"
+
+if [ ! -d $HIDL_BATCH_TEST_DIR ]; then
+    echo "cannot find test directory: $HIDL_BATCH_TEST_DIR"
+    exit 1
+fi
+
+readonly WORK_DIR=$(mktemp -d)
+trap "rm -rf $WORK_DIR" EXIT
+
+# Files are changed between lines, so the package is served from a copy.
+cp -r $HIDL_BATCH_TEST_DIR/batch $WORK_DIR/batch
+readonly ROOTS="-r android.hidl:$HIDL_TRANSPORT_DIR -r test.batch:$WORK_DIR/batch"
+
+# Sends a line to the served hidl-gen, and fails unless it succeeds.
+function serve_line() {
+    echo "$1" >&${HIDL_GEN[1]}
+    local result
+    if ! read -r result <&${HIDL_GEN[0]}; then
+        echo "error: hidl-gen -S exited while serving '$1'"
+        exit 1
+    fi
+    if [[ $result != "hidl-gen: done 0" ]]; then
+        echo "error: hidl-gen -S failed to serve '$1': $result"
+        exit 1
+    fi
+}
+
+# Changing current.txt parses every file again, including IBase.
+coproc HIDL_GEN { $HIDL_GEN_PATH -S $ROOTS; }
+serve_line "check - test.batch@1.0"
+echo "# changed" >> $WORK_DIR/batch/current.txt
+serve_line "check - test.batch@1.0"
+serve_line "c++-headers $WORK_DIR/out test.batch@1.0"
+eval "exec ${HIDL_GEN[1]}>&-"
+wait $HIDL_GEN_PID
+
+# Running lines in any of the ways below has to give the same output as
+# running each of them with a hidl-gen process of its own. @1.1 is enforced
+# before the hashes of both versions are printed, and its hash chain includes
+# the hash of @1.0, whose interface it extends.
+readonly LINES=(
+    "c++-headers OUT test.batch@1.1"
+    "c++-sources OUT test.batch@1.1"
+    "hash - test.batch@1.0::IBatch"
+    "hash - test.batch@1.1::IBatch"
+    "c++-sources OUT test.batch@1.0"
+)
+
+# Prints the lines, generating into $1.
+function lines_for() {
+    for line in "${LINES[@]}"; do
+        echo "${line/OUT/$1}"
+    done
+}
+
+# Runs each line with a hidl-gen of its own and options $2..., generating
+# into $1, and writes what they print to $1.stdout.
+function run_plain() {
+    local out=$1
+    shift
+    lines_for $out | while read -r language path fqname; do
+        local output=""
+        if [[ $path != "-" ]]; then output="-o $path"; fi
+        $HIDL_GEN_PATH $ROOTS "$@" -L $language $output $fqname || exit 1
+    done > $out.stdout
+}
+
+# Fails unless what was generated into $1 is what running each line on its
+# own generated.
+function check_same() {
+    if ! diff -r $WORK_DIR/plain $1 || ! diff $WORK_DIR/plain.stdout $1.stdout; then
+        echo "error: $2 generates different output than separate invocations"
+        exit 1
+    fi
+}
+
+function fail() {
+    echo "error: $1 failed"
+    exit 1
+}
+
+run_plain $WORK_DIR/plain || fail "hidl-gen"
+
+run_plain $WORK_DIR/jobs -j 4 || fail "hidl-gen -j"
+check_same $WORK_DIR/jobs "hidl-gen -j"
+
+lines_for $WORK_DIR/batch_file > $WORK_DIR/lines
+$HIDL_GEN_PATH $ROOTS -B $WORK_DIR/lines > $WORK_DIR/batch_file.stdout || fail "hidl-gen -B"
+check_same $WORK_DIR/batch_file "hidl-gen -B"
+
+lines_for $WORK_DIR/serve | $HIDL_GEN_PATH $ROOTS -S > $WORK_DIR/serve.all || fail "hidl-gen -S"
+if [[ $(grep -c "^hidl-gen: done 0$" $WORK_DIR/serve.all) != ${#LINES[@]} ]]; then
+    fail "hidl-gen -S"
+fi
+grep -v "^hidl-gen: done" $WORK_DIR/serve.all > $WORK_DIR/serve.stdout
+check_same $WORK_DIR/serve "hidl-gen -S"
+
+# Once to fill the cache, and once to use it.
+for run in cold warm; do
+    run_plain $WORK_DIR/cached -c $WORK_DIR/cache || fail "hidl-gen -c"
+    check_same $WORK_DIR/cached "hidl-gen -c ($run)"
+done
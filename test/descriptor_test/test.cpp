@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <descriptor/1.0/IFooDescriptors.h>
+#include <descriptor/1.0/types.h>
+#include <descriptor/1.0/typesDescriptors.h>
+
+#include <stddef.h>
+
+using namespace ::descriptor::V1_0;
+namespace d = ::descriptor::V1_0::hidl_descriptors;
+using ::android::hardware::details::hidl_descriptor_kind;
+
+#define CHECK_LAYOUT(T, descriptor)                     \
+    static_assert((descriptor).size == sizeof(T), #T); \
+    static_assert((descriptor).align == alignof(T), #T)
+
+#define CHECK_FIELD(T, descriptor, index, field)                                       \
+    static_assert(offsetof(T, field) == (descriptor##_fields)[index].offset, #field); \
+    static_assert((descriptor##_fields)[index].type->size == sizeof(T::field), #field)
+
+CHECK_LAYOUT(Padded, d::Padded);
+static_assert(d::Padded.kind == hidl_descriptor_kind::STRUCT, "");
+static_assert(d::Padded.fieldCount == 3, "");
+CHECK_FIELD(Padded, d::Padded, 0, a);
+CHECK_FIELD(Padded, d::Padded, 1, b);
+CHECK_FIELD(Padded, d::Padded, 2, c);
+
+CHECK_LAYOUT(Containers, d::Containers);
+CHECK_FIELD(Containers, d::Containers, 0, bytes);
+CHECK_FIELD(Containers, d::Containers, 1, nested);
+CHECK_FIELD(Containers, d::Containers, 2, name);
+CHECK_FIELD(Containers, d::Containers, 3, grid);
+CHECK_FIELD(Containers, d::Containers, 4, padded);
+static_assert(d::Containers_fields[1].type->kind == hidl_descriptor_kind::VECTOR, "");
+static_assert(d::Containers_fields[1].type->element->kind == hidl_descriptor_kind::VECTOR, "");
+static_assert(d::Containers_fields[1].type->element->element->size == sizeof(uint32_t), "");
+static_assert(d::Containers_fields[2].type->kind == hidl_descriptor_kind::STRING, "");
+static_assert(d::Containers_fields[3].type->kind == hidl_descriptor_kind::ARRAY, "");
+static_assert(d::Containers_fields[3].type->elementCount == 6, "");
+static_assert(d::Containers_fields[4].type->element == &d::Padded, "");
+static_assert(d::Containers_fields[4].type->elementCount == 2, "");
+
+CHECK_LAYOUT(Either, d::Either);
+static_assert(d::Either.kind == hidl_descriptor_kind::UNION, "");
+CHECK_FIELD(Either, d::Either, 0, small);
+CHECK_FIELD(Either, d::Either, 1, large);
+
+// The members of a safe_union are private, so only its layout is checked.
+CHECK_LAYOUT(Choice, d::Choice);
+static_assert(d::Choice.kind == hidl_descriptor_kind::SAFE_UNION, "");
+
+CHECK_LAYOUT(Outer::Inner, d::Outer_Inner);
+CHECK_FIELD(Outer::Inner, d::Outer_Inner, 0, x);
+CHECK_FIELD(Outer::Inner, d::Outer_Inner, 1, y);
+CHECK_LAYOUT(Outer, d::Outer);
+CHECK_FIELD(Outer, d::Outer, 0, inner);
+CHECK_FIELD(Outer, d::Outer, 1, either);
+CHECK_FIELD(Outer, d::Outer, 2, choice);
+
+// From IFoo.hal, whose descriptors of the types above are its own.
+
+static_assert(d::IFoo_methodCount == 2, "");
+static_assert(d::IFoo_methods[0].argCount == 2, "");
+static_assert(d::IFoo_methods[0].resultCount == 1, "");
+static_assert(!d::IFoo_methods[0].oneway, "");
+static_assert(d::IFoo_methods[1].oneway, "");
+static_assert(d::IFoo_take_args[0].type->size == sizeof(Padded), "");
+static_assert(d::IFoo_take_args[1].type->kind == hidl_descriptor_kind::VECTOR, "");
+static_assert(d::IFoo_take_results[0].type->size == sizeof(Containers), "");
+static_assert(d::IFoo_notify_args[0].type->size == sizeof(Outer), "");
@@ -636,6 +636,29 @@ TEST_F(HidlTest, EnumToStringTest) {
     EXPECT_EQ(toString(Grandchild::B), "B"s);
 }
 
+TEST_F(HidlTest, EnumFromStringTest) {
+    using ::android::hardware::tests::foo::V1_0::fromString;
+    IFoo::BitField bitField;
+    EXPECT_TRUE(fromString("V0", &bitField));
+    EXPECT_EQ(IFoo::BitField::V0, bitField);
+    EXPECT_TRUE(fromString("VALL", &bitField));
+    EXPECT_EQ(IFoo::BitField::VALL, bitField);
+    EXPECT_FALSE(fromString("", &bitField));
+    EXPECT_FALSE(fromString("V", &bitField));
+    EXPECT_FALSE(fromString("V00", &bitField));
+    EXPECT_EQ(IFoo::BitField::VALL, bitField) << "Failed lookups must not change the value.";
+
+    // inheritance
+    using EmptyChild = ::android::hardware::tests::foo::V1_0::EnumIterators::EmptyChild;
+    using Grandchild = ::android::hardware::tests::foo::V1_0::EnumIterators::Grandchild;
+    EmptyChild emptyChild;
+    EXPECT_TRUE(fromString("A", &emptyChild));
+    EXPECT_EQ(EmptyChild::A, emptyChild);
+    Grandchild grandchild;
+    EXPECT_TRUE(fromString("B", &grandchild));
+    EXPECT_EQ(Grandchild::B, grandchild);
+}
+
 TEST_F(HidlTest, PingTest) {
     EXPECT_OK(manager->ping());
 }
@@ -16,11 +16,18 @@
 
 #define LOG_TAG "libhidl-gen-host-utils"
 
+#include <hidl-util/Formatter.h>
+#include <hidl-util/Profiler.h>
 #include <hidl-util/StringHelper.h>
 
+#include <android-base/file.h>
 #include <gtest/gtest.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <vector>
 
+using ::android::Formatter;
+using ::android::Profiler;
 using ::android::StringHelper;
 
 class LibHidlGenUtilsTest : public ::testing::Test {};
@@ -128,6 +135,86 @@ TEST_F(LibHidlGenUtilsTest, JoinStrings) {
     EXPECT_EQ("abc.,def.,ghi", StringHelper::JoinStrings({"abc", "def", "ghi"}, ".,"));
 }
 
+static ino_t getInode(const std::string& path) {
+    struct stat st;
+    EXPECT_EQ(0, stat(path.c_str(), &st));
+    return st.st_ino;
+}
+
+TEST_F(LibHidlGenUtilsTest, FormatterWritesIfChanged) {
+    TemporaryDir dir;
+    const std::string path = std::string(dir.path) + "/out.txt";
+
+    ASSERT_TRUE((Formatter(path) << "a\n").commit());
+    std::string contents;
+    ASSERT_TRUE(android::base::ReadFileToString(path, &contents));
+    EXPECT_EQ("a\n", contents);
+    const ino_t inode = getInode(path);
+
+    // Same contents, file is not replaced.
+    ASSERT_TRUE((Formatter(path) << "a\n").commit());
+    EXPECT_EQ(inode, getInode(path));
+
+    // Same size, different contents.
+    ASSERT_TRUE((Formatter(path) << "b\n").commit());
+    ASSERT_TRUE(android::base::ReadFileToString(path, &contents));
+    EXPECT_EQ("b\n", contents);
+}
+
+TEST_F(LibHidlGenUtilsTest, FormatterDiscardsUncommitted) {
+    TemporaryDir dir;
+    const std::string path = std::string(dir.path) + "/out.txt";
+
+    { Formatter(path) << "a\n"; }
+    EXPECT_NE(0, access(path.c_str(), F_OK));
+    EXPECT_NE(0, access((path + ".tmp." + std::to_string(getpid())).c_str(), F_OK));
+
+    EXPECT_FALSE(Formatter(std::string(dir.path) + "/missing/out.txt").isValid());
+}
+
+TEST_F(LibHidlGenUtilsTest, FormatterOutput) {
+    TemporaryDir dir;
+    const std::string path = std::string(dir.path) + "/out.txt";
+
+    {
+        Formatter out(path);
+        out.sIf("x == " + std::to_string(1), [&] {
+            out << -42 << ' ' << 7u << "\n\n";
+            out.setLinePrefix("// ");
+            out << "a\n\nb\n";
+            out.unsetLinePrefix();
+        }).endl();
+        const std::vector<int> v = {1, 2, 3};
+        out.join(v.begin(), v.end(), ", ", [&](int i) { out << i; });
+        ASSERT_TRUE(out.commit());
+    }
+
+    std::string contents;
+    ASSERT_TRUE(android::base::ReadFileToString(path, &contents));
+    EXPECT_EQ("if (x == 1) {\n    -42 7\n\n    // a\n    // \n    // b\n}\n1, 2, 3", contents);
+}
+
+TEST_F(LibHidlGenUtilsTest, ProfilerTrace) {
+    TemporaryDir dir;
+    const std::string path = std::string(dir.path) + "/trace.json";
+
+    { Profiler::Phase phase("not recorded"); }
+
+    Profiler::setEnabled(true);
+    { Profiler::Phase phase("test phase", "\"detail\"\n"); }
+    ASSERT_TRUE((Formatter(std::string(dir.path) + "/out.txt") << "12345").commit());
+    Profiler::setEnabled(false);
+
+    ASSERT_TRUE(Profiler::writeTrace(path));
+    std::string contents;
+    ASSERT_TRUE(android::base::ReadFileToString(path, &contents));
+    EXPECT_EQ(0u, contents.find("{\"traceEvents\":["));
+    EXPECT_EQ(std::string::npos, contents.find("not recorded"));
+    EXPECT_NE(std::string::npos, contents.find("\"name\":\"test phase\""));
+    EXPECT_NE(std::string::npos, contents.find("\"detail\":\"\\\"detail\\\"\\u000a\""));
+    EXPECT_NE(std::string::npos, contents.find("\"bytes_emitted\":5"));
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
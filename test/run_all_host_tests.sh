@@ -4,6 +4,8 @@ function run() {
     local FAILED_TESTS=()
 
     local COMPILE_TIME_TESTS=(\
+        hidl_batch_test \
+        hidl_descriptor_test \
         hidl_error_test \
         hidl_export_test \
         hidl_hash_test \
@@ -17,12 +17,18 @@
 #define LOG_TAG "libhidl-gen-utils"
 
 #include <hidl-util/FqInstance.h>
+#include <hidl-util/InternedFQName.h>
 
+#include <android-base/parseint.h>
 #include <gtest/gtest.h>
+#include <random>
+#include <regex>
+#include <unordered_set>
 #include <vector>
 
 using ::android::FqInstance;
 using ::android::FQName;
+using ::android::InternedFQName;
 
 class LibHidlGenUtilsTest : public ::testing::Test {};
 
@@ -116,6 +122,148 @@ TEST_F(LibHidlGenUtilsTest, FqDefaultVersion) {
     EXPECT_EQ((std::make_pair<size_t, size_t>(1u, 2u)), i.getVersion());
 }
 
+TEST_F(LibHidlGenUtilsTest, FqNameHash) {
+    FQName a;
+    ASSERT_TRUE(FQName::parse("android.hardware.foo@1.0::IFoo.Type", &a));
+    FQName b = a;
+    EXPECT_EQ(a, b);
+    EXPECT_EQ(a.hash(), b.hash());
+    EXPECT_EQ(std::hash<FQName>()(a), a.hash());
+
+    // The cached hash is dropped when the name changes.
+    ASSERT_TRUE(b.setTo("android.hardware.foo@1.0::IFoo"));
+    EXPECT_NE(a, b);
+    b = a.withVersion(1, 1);
+    EXPECT_NE(a, b);
+    EXPECT_EQ(a, b.downRev());
+    EXPECT_EQ(a.hash(), b.downRev().hash());
+
+    FQName local;
+    ASSERT_TRUE(FQName::parse("IFoo.Type", &local));
+    EXPECT_NE(a.hash(), local.hash());
+    local.applyDefaults("android.hardware.foo", "1.0");
+    EXPECT_EQ(a, local);
+    EXPECT_EQ(a.hash(), local.hash());
+
+    std::unordered_set<FQName> set{a, b, local};
+    EXPECT_EQ(2u, set.size());
+}
+
+TEST_F(LibHidlGenUtilsTest, InternedFQName) {
+    FQName foo;
+    ASSERT_TRUE(FQName::parse("android.hardware.foo@1.2::IFoo.Type:VALUE", &foo));
+    FQName bar;
+    ASSERT_TRUE(FQName::parse("android.hardware.foo@1.2::IBar", &bar));
+
+    InternedFQName interned(foo);
+    EXPECT_EQ("android.hardware.foo", interned.package());
+    EXPECT_EQ((std::make_pair<size_t, size_t>(1u, 2u)), interned.getVersion());
+    EXPECT_EQ("IFoo.Type", interned.name());
+    EXPECT_EQ("VALUE", interned.valueName());
+    EXPECT_EQ(foo, interned.fqName());
+    EXPECT_EQ(FQName(), InternedFQName().fqName());
+
+    EXPECT_EQ(interned, InternedFQName(foo));
+    EXPECT_EQ(interned.hash(), InternedFQName(foo).hash());
+    EXPECT_NE(interned, InternedFQName(bar));
+    EXPECT_NE(InternedFQName(bar), InternedFQName(bar.withVersion(1, 3)));
+
+    std::unordered_set<InternedFQName> set{interned, InternedFQName(bar), InternedFQName(foo)};
+    EXPECT_EQ(2u, set.size());
+}
+
+// The regular expressions FQName::setTo used to be implemented with.
+struct RegexFQName {
+    bool valid = false;
+    bool isIdentifier = false;
+    std::string package;
+    size_t major = 0;
+    size_t minor = 0;
+    std::string name;
+    std::string valueName;
+};
+
+static RegexFQName regexParse(const std::string& s) {
+#define RE_COMPONENT "[a-zA-Z_][a-zA-Z_0-9]*"
+#define RE_PATH RE_COMPONENT "(?:[.]" RE_COMPONENT ")*"
+#define RE_VERSION "([0-9]+)[.]([0-9]+)"
+    static const std::regex kRE1("(" RE_PATH ")@" RE_VERSION "::(" RE_PATH ")");
+    static const std::regex kRE2("@" RE_VERSION "::(" RE_PATH ")");
+    static const std::regex kRE3("(" RE_PATH ")@" RE_VERSION);
+    static const std::regex kRE4("(" RE_COMPONENT ")([.]" RE_COMPONENT ")+");
+    static const std::regex kRE5("(" RE_COMPONENT ")");
+    static const std::regex kRE6("(" RE_PATH ")@" RE_VERSION "::(" RE_PATH "):(" RE_COMPONENT ")");
+    static const std::regex kRE7("@" RE_VERSION "::(" RE_PATH "):(" RE_COMPONENT ")");
+    static const std::regex kRE8("(" RE_PATH "):(" RE_COMPONENT ")");
+#undef RE_COMPONENT
+#undef RE_PATH
+#undef RE_VERSION
+
+    RegexFQName r;
+    std::string majorStr, minorStr;
+    std::smatch m;
+    if (std::regex_match(s, m, kRE1)) {
+        r.package = m.str(1), majorStr = m.str(2), minorStr = m.str(3), r.name = m.str(4);
+    } else if (std::regex_match(s, m, kRE2)) {
+        majorStr = m.str(1), minorStr = m.str(2), r.name = m.str(3);
+    } else if (std::regex_match(s, m, kRE3)) {
+        r.package = m.str(1), majorStr = m.str(2), minorStr = m.str(3);
+    } else if (std::regex_match(s, m, kRE4)) {
+        r.name = m.str(0);
+    } else if (std::regex_match(s, m, kRE5)) {
+        r.isIdentifier = true, r.name = m.str(0);
+    } else if (std::regex_match(s, m, kRE6)) {
+        r.package = m.str(1), majorStr = m.str(2), minorStr = m.str(3), r.name = m.str(4);
+        r.valueName = m.str(5);
+    } else if (std::regex_match(s, m, kRE7)) {
+        majorStr = m.str(1), minorStr = m.str(2), r.name = m.str(3), r.valueName = m.str(4);
+    } else if (std::regex_match(s, m, kRE8)) {
+        r.name = m.str(1), r.valueName = m.str(2);
+    } else {
+        return r;
+    }
+
+    r.valid = majorStr.empty() || (::android::base::ParseUint(majorStr, &r.major) &&
+                                   ::android::base::ParseUint(minorStr, &r.minor));
+    return r;
+}
+
+TEST_F(LibHidlGenUtilsTest, FqNameMatchesRegexParser) {
+    static const std::vector<std::string> kPieces = {
+        "a", "Z", "_", "0", "1", "7", ".", "@", ":", "::", "@1.0", "@12.34", "IFoo", "android.hardware",
+    };
+
+    std::mt19937 random(42);
+    auto pick = [&](size_t n) { return std::uniform_int_distribution<size_t>(0, n - 1)(random); };
+
+    std::vector<std::string> inputs = {
+        "", "@", "@1.0", "a@1.0", "a@1.0::", "a@1.0::B:", "a@1.0::B:c:d", "a..b", "a.", ".a",
+        "a@1.0::B.c:D", "@1.0::B:c", "B:c", "a@01.08::B", "a@99999999999999999999.0::B",
+    };
+    for (size_t i = 0; i < 20000; i++) {
+        std::string s;
+        size_t length = pick(10);
+        for (size_t j = 0; j < length; j++) s += kPieces[pick(kPieces.size())];
+        inputs.push_back(s);
+    }
+
+    for (const std::string& s : inputs) {
+        RegexFQName expected = regexParse(s);
+        // FQName aborts on a package with a zero major version.
+        if (expected.valid && !expected.package.empty() && expected.major == 0) continue;
+
+        FQName actual;
+        ASSERT_EQ(expected.valid, actual.setTo(s)) << s;
+        if (!expected.valid) continue;
+
+        EXPECT_EQ(expected.isIdentifier, actual.isIdentifier()) << s;
+        EXPECT_EQ(expected.package, actual.package()) << s;
+        EXPECT_EQ(std::make_pair(expected.major, expected.minor), actual.getVersion()) << s;
+        EXPECT_EQ(expected.name, actual.name()) << s;
+        EXPECT_EQ(expected.valueName, actual.valueName()) << s;
+    }
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
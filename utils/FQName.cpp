@@ -20,14 +20,8 @@
 #include <android-base/parseint.h>
 #include <android-base/strings.h>
 #include <iostream>
-#include <regex>
 #include <sstream>
 
-#define RE_COMPONENT    "[a-zA-Z_][a-zA-Z_0-9]*"
-#define RE_PATH         RE_COMPONENT "(?:[.]" RE_COMPONENT ")*"
-#define RE_MAJOR        "[0-9]+"
-#define RE_MINOR        "[0-9]+"
-
 namespace android {
 
 FQName::FQName() : mIsIdentifier(false) {}
@@ -45,6 +39,7 @@ FQName::FQName(const std::string& package, const std::string& version, const std
 
 bool FQName::setTo(const std::string& package, size_t majorVer, size_t minorVer,
                    const std::string& name, const std::string& valueName) {
+    mHash = 0;
     mPackage = package;
     mMajor = majorVer;
     mMinor = minorVer;
@@ -64,7 +59,19 @@ FQName::FQName(const FQName& other)
       mMajor(other.mMajor),
       mMinor(other.mMinor),
       mName(other.mName),
-      mValueName(other.mValueName) {}
+      mValueName(other.mValueName),
+      mHash(other.mHash.load(std::memory_order_relaxed)) {}
+
+FQName& FQName::operator=(const FQName& other) {
+    mIsIdentifier = other.mIsIdentifier;
+    mPackage = other.mPackage;
+    mMajor = other.mMajor;
+    mMinor = other.mMinor;
+    mName = other.mName;
+    mValueName = other.mValueName;
+    mHash.store(other.mHash.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    return *this;
+}
 
 bool FQName::isIdentifier() const {
     return mIsIdentifier;
@@ -83,76 +90,128 @@ bool FQName::isInterfaceName() const {
     return !mName.empty() && mName[0] == 'I' && mName.find('.') == std::string::npos;
 }
 
+namespace {
+
+// Single pass scanner for the FQName grammar, where
+//   COMPONENT = [a-zA-Z_][a-zA-Z_0-9]*
+//   PATH      = COMPONENT([.]COMPONENT)*
+//   VERSION   = [0-9]+[.][0-9]+
+struct Scanner {
+    explicit Scanner(std::string_view s) : mStr(s) {}
+
+    bool atEnd() const { return mPos == mStr.size(); }
+    size_t pos() const { return mPos; }
+    std::string_view from(size_t start) const { return mStr.substr(start, mPos - start); }
+
+    bool consume(char c) {
+        if (atEnd() || mStr[mPos] != c) return false;
+        mPos++;
+        return true;
+    }
+
+    bool component() {
+        if (atEnd() || !(isalpha(mStr[mPos]) || mStr[mPos] == '_')) return false;
+        mPos++;
+        while (!atEnd() && (isalnum(mStr[mPos]) || mStr[mPos] == '_')) mPos++;
+        return true;
+    }
+
+    // Sets *components to the number of components in the path.
+    bool path(size_t* components) {
+        *components = 0;
+        do {
+            if (!component()) return false;
+            (*components)++;
+        } while (consume('.'));
+        return true;
+    }
+
+    bool number() {
+        size_t start = mPos;
+        while (!atEnd() && isdigit(mStr[mPos])) mPos++;
+        return mPos != start;
+    }
+
+   private:
+    static bool isalpha(char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'); }
+    static bool isdigit(char c) { return c >= '0' && c <= '9'; }
+    static bool isalnum(char c) { return isalpha(c) || isdigit(c); }
+
+    std::string_view mStr;
+    size_t mPos = 0;
+};
+
+}  // namespace
+
 bool FQName::setTo(const std::string &s) {
-    // android.hardware.foo@1.0::IFoo.Type
-    static const std::regex kRE1("(" RE_PATH ")@(" RE_MAJOR ")[.](" RE_MINOR ")::(" RE_PATH ")");
-    // @1.0::IFoo.Type
-    static const std::regex kRE2("@(" RE_MAJOR ")[.](" RE_MINOR ")::(" RE_PATH ")");
-    // android.hardware.foo@1.0 (for package declaration and whole package import)
-    static const std::regex kRE3("(" RE_PATH ")@(" RE_MAJOR ")[.](" RE_MINOR ")");
-    // IFoo.Type
-    static const std::regex kRE4("(" RE_COMPONENT ")([.]" RE_COMPONENT ")+");
-    // Type (a plain identifier)
-    static const std::regex kRE5("(" RE_COMPONENT ")");
-
-    // android.hardware.foo@1.0::IFoo.Type:MY_ENUM_VALUE
-    static const std::regex kRE6("(" RE_PATH ")@(" RE_MAJOR ")[.](" RE_MINOR ")::(" RE_PATH
-                                 "):(" RE_COMPONENT ")");
-    // @1.0::IFoo.Type:MY_ENUM_VALUE
-    static const std::regex kRE7("@(" RE_MAJOR ")[.](" RE_MINOR ")::(" RE_PATH "):(" RE_COMPONENT
-                                 ")");
-    // IFoo.Type:MY_ENUM_VALUE
-    static const std::regex kRE8("(" RE_PATH "):(" RE_COMPONENT ")");
-
-    bool invalid = false;
+    // Accepts exactly one of:
+    //   android.hardware.foo@1.0::IFoo.Type
+    //   @1.0::IFoo.Type
+    //   android.hardware.foo@1.0 (for package declaration and whole package import)
+    //   IFoo.Type
+    //   Type (a plain identifier)
+    //   android.hardware.foo@1.0::IFoo.Type:MY_ENUM_VALUE
+    //   @1.0::IFoo.Type:MY_ENUM_VALUE
+    //   IFoo.Type:MY_ENUM_VALUE
     clear();
 
-    std::smatch match;
-    if (std::regex_match(s, match, kRE1)) {
-        CHECK_EQ(match.size(), 5u);
-
-        mPackage = match.str(1);
-        invalid |= !parseVersion(match.str(2), match.str(3));
-        mName = match.str(4);
-    } else if (std::regex_match(s, match, kRE2)) {
-        CHECK_EQ(match.size(), 4u);
-
-        invalid |= !parseVersion(match.str(1), match.str(2));
-        mName = match.str(3);
-    } else if (std::regex_match(s, match, kRE3)) {
-        CHECK_EQ(match.size(), 4u);
-
-        mPackage = match.str(1);
-        invalid |= !parseVersion(match.str(2), match.str(3));
-    } else if (std::regex_match(s, match, kRE4)) {
-        mName = match.str(0);
-    } else if (std::regex_match(s, match, kRE5)) {
-        mIsIdentifier = true;
-        mName = match.str(0);
-    } else if (std::regex_match(s, match, kRE6)) {
-        CHECK_EQ(match.size(), 6u);
-
-        mPackage = match.str(1);
-        invalid |= !parseVersion(match.str(2), match.str(3));
-        mName = match.str(4);
-        mValueName = match.str(5);
-    } else if (std::regex_match(s, match, kRE7)) {
-        CHECK_EQ(match.size(), 5u);
-
-        invalid |= !parseVersion(match.str(1), match.str(2));
-        mName = match.str(3);
-        mValueName = match.str(4);
-    } else if (std::regex_match(s, match, kRE8)) {
-        CHECK_EQ(match.size(), 3u);
-
-        mName = match.str(1);
-        mValueName = match.str(2);
+    Scanner scanner(s);
+    size_t components = 0;
+    if (!scanner.consume('@')) {
+        if (!scanner.path(&components)) return false;
+
+        if (scanner.atEnd()) {
+            mIsIdentifier = components == 1;
+            mName = s;
+            return true;
+        }
+
+        if (!scanner.consume('@')) {
+            // IFoo.Type:MY_ENUM_VALUE
+            size_t nameEnd = scanner.pos();
+            if (!scanner.consume(':')) return false;
+            size_t valueStart = scanner.pos();
+            if (!scanner.component() || !scanner.atEnd()) return false;
+
+            mName = s.substr(0, nameEnd);
+            mValueName = s.substr(valueStart);
+            return true;
+        }
+    }
+
+    size_t packageEnd = scanner.pos() - 1;
+
+    size_t majorStart = scanner.pos();
+    if (!scanner.number()) return false;
+    std::string_view majorStr = scanner.from(majorStart);
+    if (!scanner.consume('.')) return false;
+    size_t minorStart = scanner.pos();
+    if (!scanner.number()) return false;
+    std::string_view minorStr = scanner.from(minorStart);
+
+    size_t nameStart = 0;
+    size_t nameEnd = 0;
+    size_t valueStart = 0;
+    if (scanner.atEnd()) {
+        // A version alone is not an FQName.
+        if (packageEnd == 0) return false;
     } else {
-        invalid = true;
+        if (!scanner.consume(':') || !scanner.consume(':')) return false;
+        nameStart = scanner.pos();
+        if (!scanner.path(&components)) return false;
+        nameEnd = scanner.pos();
+        if (scanner.consume(':')) {
+            valueStart = scanner.pos();
+            if (!scanner.component()) return false;
+        }
+        if (!scanner.atEnd()) return false;
     }
 
-    // mValueName must go with mName.
-    CHECK(mValueName.empty() || !mName.empty());
+    mPackage = s.substr(0, packageEnd);
+    mName = s.substr(nameStart, nameEnd - nameStart);
+    if (valueStart != 0) mValueName = s.substr(valueStart);
+
+    bool invalid = !parseVersion(majorStr, minorStr, &mMajor, &mMinor);
 
     // package without version is not allowed.
     CHECK(invalid || mPackage.empty() || !version().empty());
@@ -184,6 +243,7 @@ std::string FQName::atVersion() const {
 }
 
 void FQName::clear() {
+    mHash = 0;
     mIsIdentifier = false;
     mPackage.clear();
     clearVersion();
@@ -195,10 +255,26 @@ void FQName::clearVersion(size_t* majorVer, size_t* minorVer) {
     *majorVer = *minorVer = 0;
 }
 
-bool FQName::parseVersion(const std::string& majorStr, const std::string& minorStr,
+// Parses a non-empty string of digits.
+static bool parseVersionNumber(std::string_view str, size_t* number) {
+    // Plain decimal numbers which cannot overflow are handled here, anything
+    // else (e.x. leading zeros) keeps the semantics of ParseUint.
+    if (str.size() > 9 || str[0] == '0') {
+        return ::android::base::ParseUint(std::string(str), number);
+    }
+
+    size_t value = 0;
+    for (char c : str) {
+        value = value * 10 + (c - '0');
+    }
+    *number = value;
+    return true;
+}
+
+bool FQName::parseVersion(std::string_view majorStr, std::string_view minorStr,
                           size_t* majorVer, size_t* minorVer) {
-    bool versionParseSuccess = ::android::base::ParseUint(majorStr, majorVer) &&
-                               ::android::base::ParseUint(minorStr, minorVer);
+    bool versionParseSuccess =
+        parseVersionNumber(majorStr, majorVer) && parseVersionNumber(minorStr, minorVer);
     if (!versionParseSuccess) {
         LOG(ERROR) << "numbers in " << majorStr << "." << minorStr << " are out of range.";
     }
@@ -206,34 +282,31 @@ bool FQName::parseVersion(const std::string& majorStr, const std::string& minorS
 }
 
 bool FQName::parseVersion(const std::string& v, size_t* majorVer, size_t* minorVer) {
-    static const std::regex kREVer("(" RE_MAJOR ")[.](" RE_MINOR ")");
-
     if (v.empty()) {
         clearVersion(majorVer, minorVer);
         return true;
     }
 
-    std::smatch match;
-    if (!std::regex_match(v, match, kREVer)) {
-        return false;
-    }
-    CHECK_EQ(match.size(), 3u);
+    Scanner scanner(v);
+    if (!scanner.number()) return false;
+    std::string_view majorStr = scanner.from(0);
+    if (!scanner.consume('.')) return false;
+    size_t minorStart = scanner.pos();
+    if (!scanner.number() || !scanner.atEnd()) return false;
 
-    return parseVersion(match.str(1), match.str(2), majorVer, minorVer);
+    return parseVersion(majorStr, scanner.from(minorStart), majorVer, minorVer);
 }
 
 bool FQName::setVersion(const std::string& v) {
+    mHash = 0;
     return parseVersion(v, &mMajor, &mMinor);
 }
 
 void FQName::clearVersion() {
+    mHash = 0;
     clearVersion(&mMajor, &mMinor);
 }
 
-bool FQName::parseVersion(const std::string& majorStr, const std::string& minorStr) {
-    return parseVersion(majorStr, minorStr, &mMajor, &mMinor);
-}
-
 const std::string& FQName::name() const {
     return mName;
 }
@@ -263,6 +336,8 @@ void FQName::applyDefaults(
     // package without version is not allowed.
     CHECK(mPackage.empty() || !version().empty());
 
+    mHash = 0;
+
     if (mPackage.empty()) {
         mPackage = defaultPackage;
     }
@@ -296,13 +371,42 @@ bool FQName::operator<(const FQName &other) const {
 }
 
 bool FQName::operator==(const FQName &other) const {
-    return string() == other.string();
+    size_t hash = mHash.load(std::memory_order_relaxed);
+    size_t otherHash = other.mHash.load(std::memory_order_relaxed);
+    if (hash != 0 && otherHash != 0 && hash != otherHash) {
+        return false;
+    }
+
+    // Same as comparing string(), which ignores the minor version if there
+    // is no major version.
+    return mName == other.mName && mPackage == other.mPackage &&
+           mValueName == other.mValueName && mMajor == other.mMajor &&
+           (!hasVersion() || mMinor == other.mMinor);
 }
 
 bool FQName::operator!=(const FQName &other) const {
     return !(*this == other);
 }
 
+size_t FQName::hash() const {
+    size_t hash = mHash.load(std::memory_order_relaxed);
+    if (hash != 0) {
+        return hash;
+    }
+
+    std::hash<std::string> hasher;
+    hash = hasher(mPackage);
+    hash = hash * 31 + hasher(mName);
+    hash = hash * 31 + hasher(mValueName);
+    hash = hash * 31 + mMajor;
+    hash = hash * 31 + (hasVersion() ? mMinor : 0);
+    if (hash == 0) hash = 1;
+
+    // Racing threads store the same value.
+    mHash.store(hash, std::memory_order_relaxed);
+    return hash;
+}
+
 const std::string& FQName::getInterfaceName() const {
     CHECK(isInterfaceName()) << mName;
 
@@ -456,6 +560,7 @@ std::pair<size_t, size_t> FQName::getVersion() const {
 
 FQName FQName::withVersion(size_t major, size_t minor) const {
     FQName ret(*this);
+    ret.mHash = 0;
     ret.mMajor = major;
     ret.mMinor = minor;
     return ret;
@@ -531,6 +636,7 @@ bool FQName::inPackage(const std::string &package) const {
 FQName FQName::downRev() const {
     FQName ret(*this);
     CHECK(ret.mMinor > 0);
+    ret.mHash = 0;
     ret.mMinor--;
     return ret;
 }
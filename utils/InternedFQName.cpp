@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "InternedFQName.h"
+
+#include <android-base/logging.h>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
+
+namespace android {
+
+namespace {
+
+// Append-only string table shared by all threads. Id 0 is the empty string.
+class StringTable {
+   public:
+    StringTable() { intern(""); }
+
+    uint32_t intern(const std::string& s) {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        auto it = mIds.find(s);
+        if (it != mIds.end()) return it->second;
+
+        CHECK(mStrings.size() < std::numeric_limits<uint32_t>::max());
+        uint32_t id = mStrings.size();
+        // deque never moves its elements, so the key stays valid.
+        mStrings.push_back(s);
+        mIds.emplace(mStrings.back(), id);
+        return id;
+    }
+
+    const std::string& get(uint32_t id) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mStrings.at(id);
+    }
+
+   private:
+    std::mutex mMutex;
+    std::deque<std::string> mStrings;
+    std::unordered_map<std::string_view, uint32_t> mIds;
+};
+
+StringTable& strings() {
+    // Never destroyed, InternedFQNames may be used by static destructors.
+    static StringTable* table = new StringTable;
+    return *table;
+}
+
+}  // namespace
+
+InternedFQName::InternedFQName(const FQName& fqName)
+    : mPackage(strings().intern(fqName.package())),
+      mName(strings().intern(fqName.name())),
+      mValueName(strings().intern(fqName.valueName())) {
+    auto [major, minor] = fqName.getVersion();
+    CHECK(major <= std::numeric_limits<uint32_t>::max() &&
+          minor <= std::numeric_limits<uint32_t>::max())
+        << fqName.string();
+    mVersion = (uint64_t(major) << 32) | minor;
+}
+
+FQName InternedFQName::fqName() const {
+    FQName fqName;
+    if (*this == InternedFQName()) {
+        return fqName;
+    }
+
+    auto [major, minor] = getVersion();
+    CHECK(fqName.setTo(package(), major, minor, name(), valueName()));
+    return fqName;
+}
+
+const std::string& InternedFQName::package() const {
+    return strings().get(mPackage);
+}
+
+std::pair<size_t, size_t> InternedFQName::getVersion() const {
+    return {mVersion >> 32, mVersion & 0xffffffff};
+}
+
+const std::string& InternedFQName::name() const {
+    return strings().get(mName);
+}
+
+const std::string& InternedFQName::valueName() const {
+    return strings().get(mValueName);
+}
+
+size_t InternedFQName::hash() const {
+    uint64_t h = mVersion;
+    for (uint64_t id : {mPackage, mName, mValueName}) {
+        h = (h ^ id) * 0x100000001b3ull;
+    }
+    return h ^ (h >> 32);
+}
+
+bool InternedFQName::operator==(const InternedFQName& other) const {
+    return mPackage == other.mPackage && mName == other.mName &&
+           mValueName == other.mValueName && mVersion == other.mVersion;
+}
+
+bool InternedFQName::operator!=(const InternedFQName& other) const {
+    return !(*this == other);
+}
+
+bool InternedFQName::operator<(const InternedFQName& other) const {
+    return std::tie(mPackage, mVersion, mName, mValueName) <
+           std::tie(other.mPackage, other.mVersion, other.mName, other.mValueName);
+}
+
+}  // namespace android
@@ -18,7 +18,10 @@
 
 #define FQNAME_H_
 
+#include <atomic>
+#include <functional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace android {
@@ -32,6 +35,7 @@ struct FQName {
            const std::string& valueName = "");
 
     FQName(const FQName& other);
+    FQName& operator=(const FQName& other);
 
     bool isIdentifier() const;
 
@@ -104,10 +108,15 @@ struct FQName {
 
     std::string string() const;
 
+    // Ordered by string(), for containers whose order ends up in output.
     bool operator<(const FQName &other) const;
     bool operator==(const FQName &other) const;
     bool operator!=(const FQName &other) const;
 
+    // Consistent with operator==. Computed once and cached until the name
+    // changes.
+    size_t hash() const;
+
     // Must be called on an interface
     // android.hardware.foo@1.0::IBar
     // -> Bar
@@ -233,14 +242,14 @@ struct FQName {
     size_t mMinor = 0;
     std::string mName;
     std::string mValueName;
+    // 0 means not computed yet.
+    mutable std::atomic<size_t> mHash{0};
 
     void clear();
 
     __attribute__((warn_unused_result)) bool setVersion(const std::string& v);
-    __attribute__((warn_unused_result)) bool parseVersion(const std::string& majorStr,
-                                                          const std::string& minorStr);
-    __attribute__((warn_unused_result)) static bool parseVersion(const std::string& majorStr,
-                                                                 const std::string& minorStr,
+    __attribute__((warn_unused_result)) static bool parseVersion(std::string_view majorStr,
+                                                                 std::string_view minorStr,
                                                                  size_t* majorVer,
                                                                  size_t* minorVer);
     __attribute__((warn_unused_result)) static bool parseVersion(const std::string& v,
@@ -256,4 +265,13 @@ extern const FQName gIManagerFqName;
 
 }  // namespace android
 
+namespace std {
+
+template <>
+struct hash<::android::FQName> {
+    size_t operator()(const ::android::FQName& fqName) const { return fqName.hash(); }
+};
+
+}  // namespace std
+
 #endif  // FQNAME_H_
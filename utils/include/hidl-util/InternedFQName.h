@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_INTERNED_FQNAME_H_
+
+#define ANDROID_INTERNED_FQNAME_H_
+
+#include <stdint.h>
+#include <functional>
+#include <string>
+#include <utility>
+
+#include <hidl-util/FQName.h>
+
+namespace android {
+
+// Compact form of an FQName for use as a key. Package, name and value name
+// are interned for the lifetime of the process and the version is packed into
+// a single integer, so copies are cheap and equality and hashing are O(1).
+// Typical usage:
+// std::unordered_set<InternedFQName> seen;
+// seen.insert(InternedFQName(fqName));
+class InternedFQName {
+   public:
+    // The empty FQName.
+    InternedFQName() = default;
+    explicit InternedFQName(const FQName& fqName);
+
+    FQName fqName() const;
+
+    const std::string& package() const;
+    std::pair<size_t, size_t> getVersion() const;
+    const std::string& name() const;
+    const std::string& valueName() const;
+
+    size_t hash() const;
+
+    bool operator==(const InternedFQName& other) const;
+    bool operator!=(const InternedFQName& other) const;
+    // Orders by intern ids, which is stable within a process but not
+    // lexicographic. Use FQName for deterministic output.
+    bool operator<(const InternedFQName& other) const;
+
+   private:
+    uint32_t mPackage = 0;
+    uint32_t mName = 0;
+    uint32_t mValueName = 0;
+    // major << 32 | minor
+    uint64_t mVersion = 0;
+};
+
+}  // namespace android
+
+namespace std {
+
+template <>
+struct hash<::android::InternedFQName> {
+    size_t operator()(const ::android::InternedFQName& fqName) const { return fqName.hash(); }
+};
+
+}  // namespace std
+
+#endif  // ANDROID_INTERNED_FQNAME_H_